@@ -15,8 +15,8 @@
  * 
  * Dependencies:
  *   This project depends on the following libraries:
- *     - LodePNG.cpp, for writing to PNG files
- *       (https://lodev.org/lodepng/)
+ *     - zlib, for compressing PNG files
+ *       (https://zlib.net/)
  *     - cxxopts.hpp, for parsing arguments
  *       (https://github.com/jarro2783/cxxopts)
  *     - json.hpp, for reading the scene files
@@ -56,10 +56,10 @@ using namespace cxxopts;
 /* Creates the default scene of three spheres. */
 RenderWorld* create_default_renderworld() {
     RenderWorld* world = new RenderWorld();
-    world->add_object(new Sphere(Vec3(0, 0, -1), 0.5, new Lambertian(Vec3(0.1, 0.2, 0.5))));
-    world->add_object(new Sphere(Vec3(0, -100.5, -1), 100, new Lambertian(Vec3(0.8, 0.8, 0.0))));
-    world->add_object(new Sphere(Vec3(1, 0, -1), 0.5, new Metal(Vec3(0.8, 0.6, 0.2), 0.0)));
-    world->add_object(new Sphere(Vec3(-1, 0, -1), 0.5, new Dielectric(Vec3(1.0, 1.0, 1.0), 1.5)));
+    world->add_object(new Sphere(Vec3(0, 0, -1), 0.5, world->add_material(Lambertian(Vec3(0.1, 0.2, 0.5)))));
+    world->add_object(new Sphere(Vec3(0, -100.5, -1), 100, world->add_material(Lambertian(Vec3(0.8, 0.8, 0.0)))));
+    world->add_object(new Sphere(Vec3(1, 0, -1), 0.5, world->add_material(Metal(Vec3(0.8, 0.6, 0.2), 0.0))));
+    world->add_object(new Sphere(Vec3(-1, 0, -1), 0.5, world->add_material(Dielectric(Vec3(1.0, 1.0, 1.0), 1.5))));
     world->optimize();
 
     return world;
@@ -83,29 +83,54 @@ Camera* create_default_camera(double vfov, double aperture, unsigned int screen_
 
 
 int main(int argc, char** argv) {
-    std::string filename, scenename, temppath;
-    unsigned int screen_width, screen_height, number_of_rays, n_threads, batch_size, vfov, fps, n_frames;
+    std::string filename, scenename, tree_strategy, tile_size, tile_order_name;
+    ObjectTreeOptions tree_options;
+    IntegratorOptions integrator_options;
+    PNGOptions png_options;
+    unsigned int screen_width, screen_height, number_of_rays, n_threads, tile_width, tile_height, vfov, fps, n_frames, frames_in_flight;
+    TileOrder tile_order;
     bool show_progressbar, correct_gamma, dynamic_writing;
     double aperture;
+    unsigned long seed;
+    double noise_threshold;
+    unsigned int min_rays, max_rays;
 
     Options arguments("RayTracer", "Renders images using a custom-written RayTracer.");
     arguments.add_options()
-        ("f,filename", "The name of the output picture (relative to the run directory). If more than one frames are rendered, this will be an .mp4.", value<string>())
+        ("f,filename", "The name of the output picture (relative to the run directory). If more than one frames are rendered, this will be a video: a .y4m file is written uncompressed by the RayTracer itself, anything else is encoded by ffmpeg.", value<string>())
         ("s,scene", "Path to the JSON file that will be used to create a RenderWorld", value<string>())
-        ("T,temppath", "Path to a folder where all the frames will be saved before creating an .mp4", value<string>())
         ("W,width", "The width (in pixels) of the output image", value<unsigned int>())
         ("H,height", "The height (in pixels) of the output image", value<unsigned int>())
         ("r,rays", "The number of rays shot per pixel", value<unsigned int>())
+        ("adaptive", "If given, samples pixels adaptively: pixels stop getting rays once the standard error of their colour is below this fraction of their brightness, and the rays saved go to noisier pixels. On average, pixels still get the given number of rays.", value<double>())
+        ("min_rays", "The number of rays every pixel gets before deciding if it needs more, when sampling adaptively.", value<unsigned int>())
+        ("max_rays", "The maximum number of rays a single pixel can get when sampling adaptively. Defaults to four times the number of rays.", value<unsigned int>())
         ("v,vfov", "Specifies the field of view for the camera.", value<unsigned int>())
         ("a,aperture", "Determines the aperture of the camera. Determines the amount of blur.", value<double>())
-        ("n,n_frames", "The number of frames that will be rendered. If this is higher than one, then a .mp4 is created.", value<unsigned int>())
+        ("n,n_frames", "The number of frames that will be rendered. If this is higher than one, then a video is created.", value<unsigned int>())
         ("F,framerate", "The framerate of the output video.", value<unsigned int>())
-        ("d,dynamic_write", "If given, writes the frame immediately to disk when rendered.")
+        ("d,dynamic_write", "If given, writes each frame to the video as soon as it is rendered instead of keeping all of them in memory.")
         ("p,progressbar", "If given, shows a progressbar to indice the render process")
         ("g,gamma", "If given, corrects the gamma before saving")
+        ("png_level", "The compression level of the output picture, from 0 (none) to 9 (smallest). Use 1 for quick previews.", value<int>())
+        ("tile", "The size of the tiles the image is rendered in, as 'N' for square tiles or 'WxH'.", value<string>())
+        ("tile_order", "The order in which tiles are rendered. Can be 'scanline', 'morton' or 'hilbert'.", value<string>())
+        ("max_depth", "The maximum number of times a ray may bounce before it is considered absorbed.", value<unsigned int>())
+        ("roulette", "If given, randomly terminates rays that carry little light instead of always following them up to the maximum depth.")
+        ("min_depth", "The number of bounces a ray always makes before it may be terminated by russian roulette.", value<unsigned int>())
+        ("packet", "The number of neighbouring pixels whose rays are traced together. Can be 1, 4, 8 or 16.", value<unsigned int>())
+        ("wavefront", "If given, every thread keeps up to this many paths in flight at once and shades them sorted by material. Overrides --packet.", value<unsigned int>())
+        ("seed", "The seed for the random generators. The same seed always gives the same image, regardless of the number of threads or the tile size and order.", value<unsigned long>())
+        ("tree", "The strategy used to build the object tree. Can be 'median' or 'sah'.", value<string>())
+        ("bins", "The number of bins per axis used when building the object tree with 'sah'.", value<unsigned int>())
+        ("leaf_size", "The maximum number of objects in a single leaf of the object tree.", value<unsigned int>())
+        ("tree_width", "The number of children per node of the object tree when hitting it. Can be 2, 4 or 8.", value<unsigned int>())
+        ("unordered", "If given, traverses the object tree left-to-right instead of visiting the nearest child first.")
+        ("rebuild", "If given, rebuilds the object tree every frame instead of refitting it to the moved objects.")
+        ("rebuild_threshold", "The factor by which the cost of a refitted object tree may grow before it is rebuilt anyway.", value<double>())
         #ifdef THREADED
         ("t,threads", "The number of threads this program runs", value<unsigned int>())
-        ("b,batch_size", "The batch size for the ThreadPool", value<unsigned int>())
+        ("in_flight", "The number of animation frames that may be rendered at the same time, so that threads that are done with one frame continue with the next. Frames that are sampled adaptively are always rendered one by one.", value<unsigned int>())
         #endif
         ;
     
@@ -121,11 +146,6 @@ int main(int argc, char** argv) {
     } else {
         scenename = "";
     }
-    if (result.count("temppath")) {
-        temppath = result["temppath"].as<string>();
-    } else {
-        temppath = "output/animation";
-    }
 
     try {
         screen_width = result["width"].as<unsigned int>();
@@ -151,6 +171,38 @@ int main(int argc, char** argv) {
         cerr << "Could not parse number of rays: " << opt.what() << endl;
         exit(-1);
     }
+    try {
+        noise_threshold = result["adaptive"].as<double>();
+    } catch (domain_error&) {
+        noise_threshold = 0;
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse noise threshold: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        min_rays = result["min_rays"].as<unsigned int>();
+    } catch (domain_error&) {
+        min_rays = 16;
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse minimum number of rays: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        max_rays = result["max_rays"].as<unsigned int>();
+    } catch (domain_error&) {
+        max_rays = 4 * number_of_rays;
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse maximum number of rays: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        seed = result["seed"].as<unsigned long>();
+    } catch (domain_error&) {
+        seed = 0;
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse seed: " << opt.what() << endl;
+        exit(-1);
+    }
     try {
         vfov = result["vfov"].as<unsigned int>();
     } catch (domain_error&) {
@@ -183,6 +235,104 @@ int main(int argc, char** argv) {
         cerr << "Could not parse aperture: " << opt.what() << endl;
         exit(-1);
     }
+    if (result.count("tree")) {
+        tree_strategy = result["tree"].as<string>();
+        if (tree_strategy == ObjectTreeStrategyNames[median_split]) {
+            tree_options.strategy = median_split;
+        } else if (tree_strategy == ObjectTreeStrategyNames[binned_sah]) {
+            tree_options.strategy = binned_sah;
+        } else {
+            cerr << "Unknown tree strategy '" << tree_strategy << "'" << endl;
+            exit(-1);
+        }
+    }
+    try {
+        tree_options.n_bins = result["bins"].as<unsigned int>();
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse number of bins: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        tree_options.max_leaf_size = result["leaf_size"].as<unsigned int>();
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse leaf size: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        tree_options.rebuild_threshold = result["rebuild_threshold"].as<double>();
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse rebuild threshold: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        tree_options.width = result["tree_width"].as<unsigned int>();
+        if (tree_options.width != 2 && tree_options.width != 4 && tree_options.width != 8) {
+            cerr << "Tree width must be 2, 4 or 8, not " << tree_options.width << endl;
+            exit(-1);
+        }
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse tree width: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        integrator_options.max_depth = result["max_depth"].as<unsigned int>();
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse maximum depth: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        integrator_options.min_depth = result["min_depth"].as<unsigned int>();
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse minimum depth: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        png_options.level = result["png_level"].as<int>();
+        if (png_options.level < 0 || png_options.level > 9) {
+            cerr << "PNG compression level must be between 0 and 9, not " << png_options.level << endl;
+            exit(-1);
+        }
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse PNG compression level: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        integrator_options.packet_size = result["packet"].as<unsigned int>();
+        if (integrator_options.packet_size != 1 && integrator_options.packet_size != 4 && integrator_options.packet_size != 8 && integrator_options.packet_size != 16) {
+            cerr << "Packet size must be 1, 4, 8 or 16, not " << integrator_options.packet_size << endl;
+            exit(-1);
+        }
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse packet size: " << opt.what() << endl;
+        exit(-1);
+    }
+    try {
+        integrator_options.wavefront_size = result["wavefront"].as<unsigned int>();
+    } catch (domain_error&) {
+        // Keep the default
+    } catch (OptionParseException& opt) {
+        cerr << "Could not parse wavefront size: " << opt.what() << endl;
+        exit(-1);
+    }
+    integrator_options.russian_roulette = result.count("roulette") != 0;
+    tree_options.ordered_traversal = result.count("unordered") == 0;
+    tree_options.refit = result.count("rebuild") == 0;
     show_progressbar = result.count("progressbar") != 0;
     correct_gamma = result.count("gamma") != 0;
     dynamic_writing = result.count("dynamic_write") != 0;
@@ -195,18 +345,54 @@ int main(int argc, char** argv) {
         cerr << "Could not parse number of threads: " << opt.what() << endl;
         exit(-1);
     }
+    tree_options.n_threads = n_threads;
+    png_options.n_threads = n_threads;
     try {
-        batch_size = result["batch_size"].as<unsigned int>();
+        frames_in_flight = result["in_flight"].as<unsigned int>();
     } catch (domain_error&) {
-        batch_size = 1000;
+        frames_in_flight = 2;
     } catch (OptionParseException& opt) {
-        cerr << "Could not parse batch size: " << opt.what() << endl;
+        cerr << "Could not parse number of frames in flight: " << opt.what() << endl;
+        exit(-1);
+    }
+    if (frames_in_flight == 0) {
+        cerr << "Number of frames in flight must be at least 1" << endl;
         exit(-1);
     }
     #else
     n_threads = 16;
-    batch_size = 1000;
+    frames_in_flight = 1;
     #endif
+    tile_width = 16;
+    tile_height = 16;
+    if (result.count("tile")) {
+        tile_size = result["tile"].as<string>();
+        size_t x = tile_size.find('x');
+        try {
+            tile_width = stoul(tile_size.substr(0, x));
+            tile_height = x == string::npos ? tile_width : stoul(tile_size.substr(x + 1));
+        } catch (logic_error&) {
+            tile_width = 0;
+        }
+        if (tile_width == 0 || tile_height == 0) {
+            cerr << "Could not parse tile size '" << tile_size << "'" << endl;
+            exit(-1);
+        }
+    }
+    tile_order = morton_order;
+    if (result.count("tile_order")) {
+        tile_order_name = result["tile_order"].as<string>();
+        if (tile_order_name == TileOrderNames[scanline_order]) {
+            tile_order = scanline_order;
+        } else if (tile_order_name == TileOrderNames[morton_order]) {
+            tile_order = morton_order;
+        } else if (tile_order_name == TileOrderNames[hilbert_order]) {
+            tile_order = hilbert_order;
+        } else {
+            cerr << "Unknown tile order '" << tile_order_name << "'" << endl;
+            exit(-1);
+        }
+    }
 
     // Fix the output file if needed
     if (filename[filename.length() - 1] == '.') {
@@ -223,19 +409,51 @@ int main(int argc, char** argv) {
     if (scenename != "") {
         cout << "  Scene used          : " << scenename << endl;
     }
-    if (n_frames > 1) {
-        cout << "  Temp output dict    : " << temppath << endl;
-    }
     cout << "  Image dimensions    : " << screen_width << "x" << screen_height << "px" << endl;
     cout << "  Number of frames    : " << n_frames << endl;
     if (n_frames > 1) {
         cout << "  Framerate           : " << fps << endl;
     }
     cout << "  Number of rays      : " << number_of_rays << endl;
+    if (n_frames == 1) {
+        cout << "  PNG compression     : level " << png_options.level << endl;
+    }
+    if (noise_threshold > 0) {
+        cout << "  Adaptive sampling   : below " << noise_threshold << " noise, " << min_rays << " to " << max_rays << " rays per pixel" << endl;
+    }
+    cout << "  Ray depth           : max " << integrator_options.max_depth;
+    if (integrator_options.russian_roulette) {
+        cout << ", russian roulette after " << integrator_options.min_depth << " bounces";
+    }
+    cout << endl;
+    if (integrator_options.wavefront_size > 0) {
+        cout << "  Wavefront           : " << integrator_options.wavefront_size << " paths" << endl;
+    } else {
+        cout << "  Ray packets         : " << integrator_options.packet_size << " rays" << endl;
+    }
+    cout << "  Seed                : " << seed << endl;
     #ifdef THREADED
     cout << "  Number of threads   : " << n_threads << endl;
-    cout << "  Batch size          : " << batch_size << endl;
+    if (n_frames > 1) {
+        cout << "  Frames in flight    : " << frames_in_flight << endl;
+    }
     #endif
+    cout << "  Tiles               : " << tile_width << "x" << tile_height << "px, " << TileOrderNames[tile_order] << " order" << endl;
+    cout << "  Object tree         : " << ObjectTreeStrategyNames[tree_options.strategy];
+    if (tree_options.strategy == binned_sah) {
+        cout << " (" << tree_options.n_bins << " bins)";
+    }
+    cout << ", max " << tree_options.max_leaf_size << " per leaf";
+    cout << ", " << tree_options.width << " wide";
+    cout << ", " << (tree_options.ordered_traversal ? "ordered" : "unordered") << " traversal" << endl;
+    if (n_frames > 1) {
+        cout << "  Tree per frame      : ";
+        if (tree_options.refit) {
+            cout << "refit (rebuild at " << tree_options.rebuild_threshold << "x cost)" << endl;
+        } else {
+            cout << "rebuild" << endl;
+        }
+    }
     cout << "  Field of view       : " << vfov << endl;
     cout << "  Aperture            : " << aperture << endl;
     cout << "  Correct for gamma   ? ";
@@ -290,11 +508,24 @@ int main(int argc, char** argv) {
         if (!j["world"].is_null()) {
             cout << "  Loading world..." << endl;
             try {
-                world = RenderWorld::from_json(j["world"]);
+                world = RenderWorld::from_json(j["world"], integrator_options);
             } catch (JSONException& e) {
                 cerr << e.what() << endl;
                 exit(-1);
             }
+
+            // Print some nice stuff
+            const IntegratorOptions& scene_options = world->get_integrator_options();
+            if (scene_options.max_depth != integrator_options.max_depth) {
+                cout << "    World: overriding maximum depth to " << scene_options.max_depth << endl;
+            }
+            if (scene_options.min_depth != integrator_options.min_depth) {
+                cout << "    World: overriding minimum depth to " << scene_options.min_depth << endl;
+            }
+            if (scene_options.russian_roulette != integrator_options.russian_roulette) {
+                cout << "    World: overriding russian roulette to " << (scene_options.russian_roulette ? "on" : "off") << endl;
+            }
+            integrator_options = scene_options;
         } else {
             cout << "  Generating world..." << endl;
             world = create_default_renderworld();
@@ -330,9 +561,14 @@ int main(int argc, char** argv) {
     }
 
 
+    // Rebuild the object tree with the chosen options
+    world->set_tree_options(tree_options);
+    world->set_integrator_options(integrator_options);
+
     // Render one picture
     cout << endl << "Rendering..." << endl;
-    Renderer renderer(n_threads, batch_size, show_progressbar);
+    Renderer renderer(n_threads, tile_width, tile_height, tile_order, show_progressbar, seed);
+    renderer.set_adaptive(noise_threshold, min_rays, max_rays);
 
     auto start = chrono::system_clock::now();
     auto stop = start;
@@ -343,15 +579,15 @@ int main(int argc, char** argv) {
         stop = chrono::system_clock::now();
 
         cout << "Writing output..." << endl;
-        out.to_png(filename);
+        out.to_png(filename, png_options);
     } else {
-        Frames out(cam->width, cam->height, n_frames, fps, temppath, dynamic_writing);
+        Frames out(cam->width, cam->height, n_frames, fps, filename, dynamic_writing, frames_in_flight);
         renderer.render_animation(world, cam, out);
 
         stop = chrono::system_clock::now();
 
-        cout << "Creating .mp4..." << endl;
-        out.to_mp4(filename);
+        cout << "Finishing video..." << endl;
+        out.finish();
     }
     auto duration = stop - start;
     auto duration_ms = chrono::duration_cast<chrono::milliseconds>(duration);
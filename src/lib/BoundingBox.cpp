@@ -21,48 +21,22 @@
 
 #include "BoundingBox.hpp"
 
-#if defined MACOS || defined _WIN32
-#define fabsf64 fabs
-#endif
-
 using namespace std;
 using namespace RayTracer;
 
 
-bool BoundingBox::hit(const Ray& ray, double t_min, double t_max) const {
-    // Fetch the correct order of the hits
-    for (int i = 0; i < 3; i++) {
-        // Compute the t's
-        double invD = 1.0 / ray.direction.get(i);
-        double t0 = (this->p1.get(i) - ray.origin.get(i)) * invD;
-        double t1 = (this->p2.get(i) - ray.origin.get(i)) * invD;
-        if (invD < 0.0) {
-            std::swap(t0, t1);
-        }
-
-        // Mix in the given min and max t values
-        t_min = t0 > t_min ? t0 : t_min;
-        t_max = t1 < t_max ? t1 : t_max;
-
-        if (t_max <= t_min) {
-            return false;
-        }
-    }
-    return true;
-}
-
 void BoundingBox::merge(const BoundingBox& other) {
     // For each of the three dimensions, find the smallest and put that in
     //   this->p1. The larger is put in this->p2.
     for (int i = 0; i < 3; i++) {
-        double a1 = this->p1.get(i);
-        double a2 = this->p2.get(i);
-        double b1 = other.p1.get(i);
-        double b2 = other.p2.get(i);
+        scalar a1 = this->p1.get(i);
+        scalar a2 = this->p2.get(i);
+        scalar b1 = other.p1.get(i);
+        scalar b2 = other.p2.get(i);
 
         // Order the A-box values
-        double min = a1;
-        double max = a2;
+        scalar min = a1;
+        scalar max = a2;
         if (min > max) {
             min = max;
             max = a1;
@@ -86,9 +60,16 @@ void BoundingBox::merge(const BoundingBox& other) {
     }
 }
 
-double BoundingBox::size() const {
-    double dx = fabsf64(this->p1.x - this->p2.x);
-    double dy = fabsf64(this->p1.y - this->p2.y);
-    double dz = fabsf64(this->p1.z - this->p2.z);
+scalar BoundingBox::size() const {
+    scalar dx = fabs(this->p1.x - this->p2.x);
+    scalar dy = fabs(this->p1.y - this->p2.y);
+    scalar dz = fabs(this->p1.z - this->p2.z);
     return dx * dy * dz;
 }
+
+scalar BoundingBox::surface() const {
+    scalar dx = fabs(this->p1.x - this->p2.x);
+    scalar dy = fabs(this->p1.y - this->p2.y);
+    scalar dz = fabs(this->p1.z - this->p2.z);
+    return 2 * (dx * dy + dy * dz + dz * dx);
+}
\ No newline at end of file
@@ -56,19 +56,19 @@ Camera::Camera(Vec3 lookfrom, Vec3 lookat, Vec3 up, double vfov, double aperture
 
 
 
-Ray Camera::get_ray(int x, int y) const {
+Ray Camera::get_ray(int x, int y, Random& rng) const {
     // Compute u and v
     double s, t;
     if (this->rays > 1) {
-        s = double(x + random_double()) / double(this->width);
-        t = double(this->height - 1 - y + random_double()) / double(this->height);
+        s = double(x + random_double(rng)) / double(this->width);
+        t = double(this->height - 1 - y + random_double(rng)) / double(this->height);
     } else {
         s = double(x) / double(this->width);
         t = double(this->height - 1 - y) / double(this->height);
     }
 
     // Return a ray shot through this pixel
-    Vec3 rd = this->lens_radius * random_in_unit_disc();
+    Vec3 rd = this->lens_radius * random_in_unit_disc(rng);
     Vec3 offset = this->u * rd.x + this->v * rd.y;
     return Ray(this->origin + offset, this->lower_left_corner + s * this->horizontal + t * this->vertical - this->origin - offset);
 }
@@ -113,9 +113,9 @@ void Camera::update(std::chrono::milliseconds time_passed){
 
 json Camera::to_json() const {
     json j;
-    j["lookat"] = this->lookat.to_json();
-    j["lookfrom"] = this->lookfrom.to_json();
-    j["up"] = this->up.to_json();
+    j["lookat"] = this->lookat;
+    j["lookfrom"] = this->lookfrom;
+    j["up"] = this->up;
     j["vfov"] = this->vfov;
     j["aperture"] = this->aperture;
     if (this->animation != nullptr) {
@@ -148,9 +148,9 @@ Camera* Camera::from_json(nlohmann::json json_obj) {
     }
 
     // Parse the objects
-    Vec3 lookat = Vec3::from_json(json_obj["lookat"]);
-    Vec3 lookfrom = Vec3::from_json(json_obj["lookfrom"]);
-    Vec3 up = Vec3::from_json(json_obj["up"]);
+    Vec3 lookat = json_obj["lookat"].get<Vec3>();
+    Vec3 lookfrom = json_obj["lookfrom"].get<Vec3>();
+    Vec3 up = json_obj["up"].get<Vec3>();
     double vfov, aperture;
     try {
         vfov = json_obj["vfov"].get<double>();
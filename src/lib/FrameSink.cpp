@@ -0,0 +1,234 @@
+/* FRAME SINK.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 23:10:46
+ * Last edited:
+ *   18/10/2026, 23:10:46
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   A FrameSink takes the frames of an animation one by one and turns them
+ *   into a video. The FFmpegSink streams the raw pixels over a pipe to an
+ *   ffmpeg process, which encodes them while the next frame renders, and
+ *   the Y4MSink writes them uncompressed to a YUV4MPEG2 file without
+ *   needing any external program. Neither needs temporary files. This
+ *   particular file is the implementation file for FrameSink.hpp.
+**/
+
+#include <cctype>
+#include <stdexcept>
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "StringError.hpp"
+#include "FrameSink.hpp"
+
+extern char** environ;
+
+using namespace std;
+using namespace RayTracer;
+
+
+/* Returns whether given path ends with given extension, ignoring case. */
+static bool has_extension(const string& path, const string& extension) {
+    if (path.length() < extension.length()) {
+        return false;
+    }
+    for (size_t i = 0; i < extension.length(); i++) {
+        if (tolower(path[path.length() - extension.length() + i]) != extension[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+FrameSink::FrameSink(unsigned int width, unsigned int height, unsigned int fps)
+    : width(width),
+    height(height),
+    fps(fps)
+{}
+
+FrameSink* FrameSink::open(const std::string& path, unsigned int width, unsigned int height, unsigned int fps) {
+    if (has_extension(path, ".y4m")) {
+        return new Y4MSink(path, width, height, fps);
+    }
+    return new FFmpegSink(path, width, height, fps);
+}
+
+
+
+FFmpegSink::FFmpegSink(const std::string& path, unsigned int width, unsigned int height, unsigned int fps)
+    : FrameSink(width, height, fps),
+    pid(-1),
+    fd(-1),
+    buffer(3 * (size_t) width * height)
+{
+    // ffmpeg reads raw frames from its stdin, and overwrites the output without asking since stdin isn't a terminal anymore
+    vector<string> args = {
+        "ffmpeg", "-y", "-loglevel", "error",
+        "-f", "rawvideo", "-pix_fmt", "rgb24", "-s", to_string(width) + "x" + to_string(height), "-r", to_string(fps), "-i", "-",
+        "-vcodec", "libx264", "-crf", "25", "-pix_fmt", "yuv420p", path
+    };
+    vector<char*> argv;
+    for (size_t i = 0; i < args.size(); i++) {
+        argv.push_back((char*) args[i].c_str());
+    }
+    argv.push_back(nullptr);
+
+    // Don't let any other child processes inherit our end of the pipe, or ffmpeg never sees it close. Setting this when the pipe is made leaves no window in which another thread could spawn one.
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        throw runtime_error("Could not create pipe to ffmpeg: " + string_error(errno));
+    }
+
+    // Start ffmpeg directly (not through a shell) with the read end of the pipe as its stdin
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    int res = posix_spawnp(&this->pid, "ffmpeg", &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fds[0]);
+    if (res != 0) {
+        ::close(fds[1]);
+        this->pid = -1;
+        throw runtime_error("Could not start ffmpeg: " + string_error(res));
+    }
+    this->fd = fds[1];
+}
+
+FFmpegSink::~FFmpegSink() {
+    if (this->fd >= 0) {
+        ::close(this->fd);
+    }
+    if (this->pid > 0) {
+        waitpid(this->pid, nullptr, 0);
+    }
+}
+
+
+
+void FFmpegSink::write(const Image& frame) {
+    if (this->fd < 0) {
+        throw runtime_error("Cannot write a frame to a closed FFmpegSink");
+    }
+
+    size_t stride = 3 * (size_t) this->width;
+    for (unsigned int y = 0; y < this->height; y++) {
+        frame.row_to_bytes(y, this->buffer.data() + y * stride);
+    }
+
+    // If ffmpeg quits early, we want write() to report it instead of being killed by SIGPIPE. Blocking the signal on this thread only while writing leaves the rest of the process alone.
+    sigset_t sigpipe, old_mask, pending;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, &old_mask);
+    sigpending(&pending);
+    bool was_pending = sigismember(&pending, SIGPIPE);
+
+    // The pipe takes as much as fits in its buffer at a time
+    size_t written = 0;
+    int error = 0;
+    while (written < this->buffer.size()) {
+        ssize_t res = ::write(this->fd, this->buffer.data() + written, this->buffer.size() - written);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = errno;
+            break;
+        }
+        written += (size_t) res;
+    }
+
+    // Swallow the SIGPIPE we caused before unblocking, so it isn't delivered after all
+    if (error == EPIPE && !was_pending) {
+        struct timespec no_wait = { 0, 0 };
+        while (sigtimedwait(&sigpipe, nullptr, &no_wait) < 0 && errno == EINTR) {}
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    if (error != 0) {
+        throw runtime_error("Could not send frame to ffmpeg: " + string_error(error));
+    }
+}
+
+void FFmpegSink::close() {
+    if (this->fd < 0) {
+        return;
+    }
+
+    // Closing the pipe tells ffmpeg there are no more frames
+    ::close(this->fd);
+    this->fd = -1;
+
+    int status;
+    pid_t pid = this->pid;
+    this->pid = -1;
+    if (waitpid(pid, &status, 0) < 0) {
+        throw runtime_error("Could not wait for ffmpeg: " + string_error(errno));
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw runtime_error("ffmpeg failed with exit status " + to_string(WIFEXITED(status) ? WEXITSTATUS(status) : -1));
+    }
+}
+
+
+
+Y4MSink::Y4MSink(const std::string& path, unsigned int width, unsigned int height, unsigned int fps)
+    : FrameSink(width, height, fps),
+    file(path, ios::binary),
+    rgb(3 * (size_t) width),
+    planes(3 * (size_t) width * height)
+{
+    if (!this->file.is_open()) {
+        throw runtime_error("Could not open '" + path + "' for writing");
+    }
+
+    // Progressive frames with square pixels and no chroma subsampling
+    this->file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C444\n";
+}
+
+
+
+void Y4MSink::write(const Image& frame) {
+    size_t n_pixels = (size_t) this->width * this->height;
+    unsigned char* y_plane = this->planes.data();
+    unsigned char* cb_plane = y_plane + n_pixels;
+    unsigned char* cr_plane = cb_plane + n_pixels;
+
+    for (unsigned int y = 0; y < this->height; y++) {
+        frame.row_to_bytes(y, this->rgb.data());
+        size_t offset = (size_t) y * this->width;
+        for (unsigned int x = 0; x < this->width; x++) {
+            // Studio range BT.601 in fixed point, which is what y4m readers assume without a colour range tag
+            int r = this->rgb[3 * x], g = this->rgb[3 * x + 1], b = this->rgb[3 * x + 2];
+            y_plane[offset + x] = (unsigned char) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            cb_plane[offset + x] = (unsigned char) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            cr_plane[offset + x] = (unsigned char) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    this->file << "FRAME\n";
+    this->file.write((const char*) this->planes.data(), this->planes.size());
+    if (!this->file) {
+        throw runtime_error("Could not write frame to y4m file");
+    }
+}
+
+void Y4MSink::close() {
+    if (this->file.is_open()) {
+        this->file.close();
+        if (this->file.fail()) {
+            throw runtime_error("Could not finish y4m file");
+        }
+    }
+}
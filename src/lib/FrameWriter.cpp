@@ -0,0 +1,159 @@
+/* FRAME WRITER.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 23:52:21
+ * Last edited:
+ *   18/10/2026, 23:52:21
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   The FrameWriter class owns a small, fixed set of frame buffers that
+ *   are handed out to be rendered into, and writes the finished ones to
+ *   a FrameSink. If compiled with THREADED, the writing happens on a
+ *   background thread, so that the next frame can be rendered at the
+ *   same time; rendering only has to wait for the writer if all buffers
+ *   are in use. This particular file is the implementation file for
+ *   FrameWriter.hpp.
+**/
+
+#include <stdexcept>
+
+#include "FrameWriter.hpp"
+
+using namespace std;
+using namespace RayTracer;
+
+
+FrameWriter::FrameWriter(FrameSink* sink, unsigned int width, unsigned int height, unsigned int n_buffers)
+    : sink(sink)
+{
+    // Allocate all buffers up front, so that no frame has to allocate one
+    for (unsigned int i = 0; i < (n_buffers > 0 ? n_buffers : 1); i++) {
+        Image* buffer = new Image(width, height);
+        this->buffers.push_back(buffer);
+        this->free_buffers.push_back(buffer);
+    }
+
+    #ifdef THREADED
+    this->stopping = false;
+    this->writer = thread(&FrameWriter::worker, this);
+    #endif
+}
+
+FrameWriter::~FrameWriter() {
+    #ifdef THREADED
+    if (this->writer.joinable()) {
+        {
+            lock_guard<mutex> l_lock(this->lock);
+            this->pending.clear();
+            this->stopping = true;
+        }
+        this->pending_cond.notify_all();
+        this->writer.join();
+    }
+    #endif
+
+    for (size_t i = 0; i < this->buffers.size(); i++) {
+        delete this->buffers[i];
+    }
+}
+
+
+
+#ifdef THREADED
+void FrameWriter::worker() {
+    unique_lock<mutex> u_lock(this->lock);
+    while (true) {
+        // Sleep until there is a frame to write or we're stopping
+        this->pending_cond.wait(u_lock, [this](){ return !this->pending.empty() || this->stopping; });
+        if (this->pending.empty()) { return; }
+        Image* frame = this->pending.front();
+        this->pending.pop_front();
+
+        // Write it without holding the lock, so that the renderer can submit and acquire in the meantime
+        u_lock.unlock();
+        this->write(frame);
+        u_lock.lock();
+
+        this->free_buffers.push_back(frame);
+        this->free_cond.notify_all();
+    }
+}
+#endif
+
+void FrameWriter::write(Image* frame) {
+    #ifdef THREADED
+    {
+        lock_guard<mutex> l_lock(this->lock);
+        if (!this->error.empty()) { return; }
+    }
+    #else
+    if (!this->error.empty()) { return; }
+    #endif
+
+    try {
+        this->sink->write(*frame);
+    } catch (runtime_error& e) {
+        #ifdef THREADED
+        lock_guard<mutex> l_lock(this->lock);
+        #endif
+        this->error = e.what();
+    }
+}
+
+
+
+Image& FrameWriter::acquire() {
+    #ifdef THREADED
+    unique_lock<mutex> u_lock(this->lock);
+    this->free_cond.wait(u_lock, [this](){ return !this->free_buffers.empty(); });
+    #else
+    if (this->free_buffers.empty()) {
+        throw logic_error("All " + to_string(this->buffers.size()) + " buffers of the FrameWriter are in use");
+    }
+    #endif
+
+    Image* buffer = this->free_buffers.front();
+    this->free_buffers.pop_front();
+    return *buffer;
+}
+
+void FrameWriter::submit(Image& frame) {
+    #ifdef THREADED
+    {
+        lock_guard<mutex> l_lock(this->lock);
+        if (!this->error.empty()) {
+            throw runtime_error(this->error);
+        }
+        this->pending.push_back(&frame);
+    }
+    this->pending_cond.notify_all();
+    #else
+    // Without threads, there is nobody else to write the frame, so do it now
+    this->write(&frame);
+    this->free_buffers.push_back(&frame);
+    if (!this->error.empty()) {
+        throw runtime_error(this->error);
+    }
+    #endif
+}
+
+void FrameWriter::close() {
+    #ifdef THREADED
+    if (this->writer.joinable()) {
+        // The writer only stops once everything pending is written
+        {
+            lock_guard<mutex> l_lock(this->lock);
+            this->stopping = true;
+        }
+        this->pending_cond.notify_all();
+        this->writer.join();
+    }
+    #endif
+
+    if (!this->error.empty()) {
+        throw runtime_error(this->error);
+    }
+}
@@ -4,7 +4,7 @@
  * Created:
  *   1/31/2020, 2:25:02 PM
  * Last edited:
- *   2/9/2020, 12:59:31 AM
+ *   18/10/2026, 23:24:11
  * Auto updated?
  *   Yes
  *
@@ -13,110 +13,86 @@
  *   render a little movie. In contrast to a simple list of Images, the
  *   animation also holds information about the framerate and number of
  *   frames, and can dynamically output frames while rendering to reduce
- *   the memory impact. This particular file is the implementation for
- *   Frames.hpp.
+ *   the memory impact. The frames are written to a FrameSink, which turns
+ *   them into a video without any intermediate files. When writing
+ *   dynamically, a FrameWriter writes finished frames in the background
+ *   and recycles their buffers. This particular file is the
+ *   implementation for Frames.hpp.
 **/
 
 #include <iostream>
-#include <fstream>
+#include <stdexcept>
 
 #include "Frames.hpp"
-#include "StringError.hpp"
 
 using namespace std;
 using namespace RayTracer;
 
-Frames::Frames(unsigned int width, unsigned int height, unsigned int num_of_frames, unsigned int framerate, std::string temp_dir, bool dynamic_write)
-    : frame_index(0),
-    temp_dir(temp_dir),
+Frames::Frames(unsigned int width, unsigned int height, unsigned int num_of_frames, unsigned int framerate, std::string path, bool dynamic_write, unsigned int frames_in_flight)
+    : frames(nullptr),
+    frame_index(0),
     dynamic_writing(dynamic_write),
     width(width),
     height(height),
     n_frames(num_of_frames),
-    fps(framerate)
+    fps(framerate),
+    frames_in_flight(frames_in_flight > 0 ? frames_in_flight : 1)
 {
-    // Touch a file in the temp dir to make sure that the director exists
-    ofstream temp_check(temp_dir + "/out1.png");
-    if (!temp_check.is_open()) {
-        cerr << "temp_dir existance check failed: " << string_error(errno) << endl;
+    // Open the video, so that frames can be written to it as soon as they're done
+    try {
+        this->sink = FrameSink::open(path, this->width, this->height, this->fps);
+    } catch (runtime_error& e) {
+        cerr << "Could not open video '" << path << "': " << e.what() << endl;
         exit(-1);
     }
-    temp_check.close();
 
-    // Delete all .png files starting with out and ending in .png in the folder
-    string command = "rm -r "+ temp_dir + "/out*.png";
-    int res = system(command.c_str());
-    if (res != 0) {
-        cerr << "WARNING: Could not remove .png files in the temporary output folder." << endl;
-    }
-
-    // Initialize the first frame
-    this->current_frame = new Image(this->width, this->height);
-
-    // If everything should be kept in memory, allocate and sync the frames list as well
+    // If everything should be kept in memory, allocate the frames list; otherwise, the writer provides the frames, with a buffer for every frame in flight
     if (!this->dynamic_writing) {
+        this->writer = nullptr;
         this->frames = new Image*[this->n_frames];
-        this->frames[this->frame_index] = this->current_frame;
-    } 
-}
-
-Frames::Frames(const Frames& other)
-    : frame_index(other.frame_index),
-    temp_dir(other.temp_dir),
-    dynamic_writing(other.dynamic_writing),
-    width(other.width),
-    height(other.height),
-    n_frames(other.n_frames),
-    fps(other.fps)
-{
-    // Depending on whether we write dynamically, copy the necessary data
-    if (this->dynamic_writing) {
-        // Copy the current_frame, done
-        this->current_frame = new Image(*other.current_frame);
-    } else {
-        // Copy their entire this->frames list
-        this->frames = new Image*[this->n_frames];
-        for (std::size_t i = 0; i <= this->frame_index; i++) {
-            this->frames[i] = new Image(*other.frames[i]);
+        for (std::size_t i = 0; i < this->n_frames; i++) {
+            this->frames[i] = nullptr;
         }
-        // Update the current_frame
-        this->current_frame = this->frames[frame_index];
+    } else {
+        this->writer = new FrameWriter(this->sink, this->width, this->height, FRAMEWRITER_BUFFERS - 1 + this->frames_in_flight);
     }
 }
 
 Frames::Frames(Frames&& other)
-    : frame_index(other.frame_index),
-    temp_dir(other.temp_dir),
+    : in_flight(std::move(other.in_flight)),
+    frames(other.frames),
+    frame_index(other.frame_index),
     dynamic_writing(other.dynamic_writing),
+    sink(other.sink),
+    writer(other.writer),
     width(other.width),
     height(other.height),
     n_frames(other.n_frames),
-    fps(other.fps)
+    fps(other.fps),
+    frames_in_flight(other.frames_in_flight)
 {
-    // Copy the correct pointers
-    if (this->dynamic_writing) {
-        this->current_frame = other.current_frame;
-    } else {
-        this->frames = other.frames;
-        this->current_frame = this->frames[this->frame_index];
-    }
-
-    // Overwrite the other pointer with null
+    // Overwrite the other pointers with null
     other.frames = nullptr;
-    other.current_frame = nullptr;
+    other.sink = nullptr;
+    other.writer = nullptr;
 }
 
 Frames::~Frames() {
-    // Deallocate either everything or only the current frame
+    // Deallocate either all frames or the writer with its buffers
     if (!this->dynamic_writing) {
-        for (std::size_t i = 0; i <= this->frame_index; i++) {
-            delete this->frames[i];
+        if (this->frames != nullptr) {
+            for (std::size_t i = 0; i < this->n_frames; i++) {
+                delete this->frames[i];
+            }
+            // Delete the list as well
+            delete[] this->frames;
         }
-        // Delete the list as well
-        delete[] this->frames;
     } else {
-        delete this->current_frame;
+        delete this->writer;
     }
+
+    // Stops ffmpeg if finish() wasn't called
+    delete this->sink;
 }
 
 
@@ -127,56 +103,66 @@ void Frames::next() {
         return;
     }
 
-    // Depending on whether we should keep everything in memory, write current image to disk and delete it
+    // Depending on whether we should keep everything in memory, hand the current image to the writer
+    Image& frame = this->get_current_frame();
     if (this->dynamic_writing) {
-        this->current_frame->to_png(this->temp_dir + "/out" + to_string(this->frame_index) + ".png");
-
-        delete this->current_frame;
+        try {
+            this->writer->submit(frame);
+        } catch (runtime_error& e) {
+            cerr << "Could not write frame " << this->frame_index << " to video: " << e.what() << endl;
+            exit(1);
+        }
     }
 
-    // Create a new frame
+    // Move onto the next frame
+    this->in_flight.pop_front();
     this->frame_index++;
-    this->current_frame = new Image(this->width, this->height);
-
-    // If we should keep everything in memory, update the frames list
-    if (!this->dynamic_writing) {
-        this->frames[this->frame_index] = this->current_frame;
-    }
 }
 
 ImageRow Frames::operator[](int index) {
     // Wrap the operator of the internal current frame
-    return this->current_frame->operator[](index);
+    return this->get_current_frame()[index];
 }
 
 Image& Frames::get_current_frame() {
-    return *this->current_frame;
+    return this->get_frame(this->frame_index);
 }
 
-void Frames::to_mp4(string path) {
-    // If we haven't, write all images to file
-    if (!this->dynamic_writing) {
-        for (std::size_t i = 0; i <= this->frame_index; i++) {
-            this->frames[i]->to_png(this->temp_dir + "/out" + to_string(i) + ".png");
+Image& Frames::get_frame(std::size_t index) {
+    if (index < this->frame_index || index >= this->n_frames || index >= this->frame_index + this->frames_in_flight) {
+        throw out_of_range("Cannot get frame " + to_string(index) + " while at frame " + to_string(this->frame_index) + " of " + to_string(this->n_frames) + " with " + to_string(this->frames_in_flight) + " in flight");
+    }
+
+    // Hand out the frames up to the given one, in order
+    while (this->frame_index + this->in_flight.size() <= index) {
+        Image* frame;
+        if (this->dynamic_writing) {
+            // Only waits if the writer is still busy with all other buffers
+            frame = &this->writer->acquire();
+        } else {
+            frame = new Image(this->width, this->height);
+            this->frames[this->frame_index + this->in_flight.size()] = frame;
         }
+        this->in_flight.push_back(frame);
     }
+    return *this->in_flight[index - this->frame_index];
+}
+
+void Frames::finish() {
+    try {
+        // If we haven't, write all finished frames to the video
+        if (!this->dynamic_writing) {
+            for (std::size_t i = 0; i < this->frame_index; i++) {
+                this->sink->write(*this->frames[i]);
+            }
+        } else {
+            this->writer->close();
+        }
 
-    // Release ffmpeg on the files
-    string command = "ffmpeg ";
-    command += "-r " + to_string(this->fps);
-    command += " -f image2";
-    command += " -s " + to_string(this->width) + "x" + to_string(this->height);
-    command += " -i \"" + this->temp_dir + "/out%d.png\"";
-    command += " -vcodec libx264";
-    command += " -crf 25";
-    command += " -pix_fmt yuv420p";
-    command += " \"" + path + "\"";
-
-    cout << "Running ffmpeg with command: '" + command + "'" << endl;
-
-    int res = system(command.c_str());
-    if (res != 0) {
-        cerr << "WARNING: ffmpeg run failed." << endl;
+        this->sink->close();
+    } catch (runtime_error& e) {
+        cerr << "Could not write video: " << e.what() << endl;
+        exit(1);
     }
 }
 
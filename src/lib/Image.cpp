@@ -22,7 +22,6 @@
 #include <cstring>
 
 #include "Image.hpp"
-#include "LodePNG.hpp"
 
 using namespace std;
 using namespace RayTracer;
@@ -118,6 +117,14 @@ Image::~Image() {
 
 
 
+void Image::check(unsigned int x, unsigned int y) const {
+    if (x >= this->width || y >= this->height) {
+        throw out_of_range("Pixel at (" + to_string(x) + ", " + to_string(y) + ") is out of range for Image with size (" + to_string(this->width) + ", " + to_string(this->height) + ")");
+    }
+}
+
+
+
 Pixel Image::pixel(unsigned int row, unsigned int col) {
     // Check if the indices are within bounds
     if (row >= this->width || col >= this->height) {
@@ -140,24 +147,20 @@ ImageRow Image::operator[](unsigned int index) {
     return ImageRow(row, this->width);
 }
 
-void Image::to_png(std::string path) {
-    // Generate a 0-255, four channel vector
-    std::vector<unsigned char> raw_image;
-    raw_image.resize(this->width * this->height * 4);
-    for (unsigned int y = 0; y < this->height; y++) {
-        for (unsigned int x = 0; x < this->width; x++) {
-            // Store the data as 0-255 Red Green Blue Alhpa
-            raw_image[4 * (y * this->width + x) + 0] = (char) (255.0 * this->operator[](y)[x][0]);
-            raw_image[4 * (y * this->width + x) + 1] = (char) (255.0 * this->operator[](y)[x][1]);
-            raw_image[4 * (y * this->width + x) + 2] = (char) (255.0 * this->operator[](y)[x][2]);
-            raw_image[4 * (y * this->width + x) + 3] = 255;
-        }
+void Image::row_to_bytes(unsigned int y, unsigned char* out) const {
+    const double* in = this->row(y);
+    for (std::size_t i = 0; i < 3 * (std::size_t) this->width; i++) {
+        // Clamp before converting, since converting a value outside of [0, 256) to an unsigned char is undefined (this also maps NaN to 0)
+        double value = 255.0 * in[i];
+        out[i] = value > 0.0 ? (value < 255.0 ? (unsigned char) value : 255) : 0;
     }
+}
 
-    // Write that to the output file using LodePNG
-    unsigned result = lodepng::encode(path.c_str(), raw_image, this->width, this->height);
-    if (result != 0) {
-        cerr << "Could not write to PNG file: " << lodepng_error_text(result) << endl;
+void Image::to_png(std::string path, const PNGOptions& options) const {
+    try {
+        write_png(*this, path, options);
+    } catch (runtime_error& e) {
+        cerr << "Could not write to PNG file: " << e.what() << endl;
         exit(1);
     }
 }
\ No newline at end of file
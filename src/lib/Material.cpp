@@ -35,6 +35,12 @@ Material::Material(MaterialType material_type)
 
 
 
+bool Material::is_coherent() const {
+    return false;
+}
+
+
+
 void Material::baseclass_to_json(json& json_obj) const {
     json_obj["type"] = (unsigned long) this->type;
 }
@@ -0,0 +1,141 @@
+/* MATERIAL TABLE.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 21:12:51
+ * Last edited:
+ *   18/10/2026, 21:12:51
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   The MaterialTable class stores all materials of a RenderWorld next to
+ *   each other, without any duplicates. Objects and HitRecords refer to a
+ *   material by its index in the table instead of owning a copy of their
+ *   own, and the table scatters rays with a switch on the MaterialType
+ *   instead of through the vtable. This particular file is the
+ *   implementation file for MaterialTable.hpp.
+**/
+
+#include "JSONExceptions.hpp"
+#include "MaterialTable.hpp"
+
+using namespace std;
+using namespace RayTracer;
+using namespace nlohmann;
+
+
+/* Returns a copy of given material as an entry for the table. */
+static MaterialEntry make_entry(const Material& material) {
+    switch (material.type) {
+        case lambertian:
+            return MaterialEntry(in_place_type<Lambertian>, (const Lambertian&) material);
+        case metal:
+            return MaterialEntry(in_place_type<Metal>, (const Metal&) material);
+        case dielectric:
+            return MaterialEntry(in_place_type<Dielectric>, (const Dielectric&) material);
+        default:
+            throw UnknownSubtypeException("MaterialTable", material.type);
+    }
+}
+
+
+
+MaterialTable::MaterialTable() {}
+
+MaterialTable::MaterialTable(const MaterialTable& other)
+    : entries(other.entries),
+    lookup(other.lookup)
+{}
+
+MaterialTable::MaterialTable(MaterialTable&& other)
+    : entries(std::move(other.entries)),
+    lookup(std::move(other.lookup))
+{}
+
+
+
+uint32_t MaterialTable::add(const Material& material) {
+    // Materials are equal if they have the same type and properties, which is exactly what their json says
+    string key = material.to_json().dump();
+    unordered_map<string, uint32_t>::iterator iter = this->lookup.find(key);
+    if (iter != this->lookup.end()) {
+        return iter->second;
+    }
+
+    uint32_t index = (uint32_t) this->entries.size();
+    this->entries.push_back(make_entry(material));
+    this->lookup.insert(make_pair(key, index));
+    return index;
+}
+
+const Material& MaterialTable::operator[](uint32_t index) const {
+    if (index >= this->entries.size()) {
+        throw std::out_of_range("Index " + to_string(index) + " is out of range for MaterialTable with size " + to_string(this->entries.size()));
+    }
+    return visit([](const Material& material) -> const Material& { return material; }, this->entries[index]);
+}
+
+
+
+bool MaterialTable::is_coherent(uint32_t index) const {
+    // Only metals without fuzz are coherent, so don't bother with the others
+    if (this->type(index) == metal) {
+        return this->get<Metal>(index).Metal::is_coherent();
+    }
+    return false;
+}
+
+
+
+MaterialTable& MaterialTable::operator=(MaterialTable other) {
+    // Only do some stuff if this != other
+    if (this != &other) {
+        // Swap this data with the other data
+        swap(*this, other);
+    }
+    return *this;
+}
+
+MaterialTable& MaterialTable::operator=(MaterialTable&& other) {
+    // Only do stuff if this != other
+    if (this != &other) {
+        // Swap this with other, since other is to be deallocated anyway
+        swap(*this, other);
+    }
+    return *this;
+}
+
+void RayTracer::swap(MaterialTable& first, MaterialTable& second) {
+    using std::swap;
+
+    swap(first.entries, second.entries);
+    swap(first.lookup, second.lookup);
+}
+
+
+
+json MaterialTable::to_json() const {
+    json j = json::array();
+    for (size_t i = 0; i < this->entries.size(); i++) {
+        j[i] = (*this)[i].to_json();
+    }
+    return j;
+}
+
+MaterialTable MaterialTable::from_json(json json_obj) {
+    // Check if the object has an array type
+    if (!json_obj.is_array()) {
+        throw InvalidObjectFormat("MaterialTable", json::array().type_name(), json_obj.type_name());
+    }
+
+    // Add the materials one by one, and keep duplicates so that the indices don't shift
+    MaterialTable table;
+    for (size_t i = 0; i < json_obj.size(); i++) {
+        Material* material = Material::from_json(json_obj[i]);
+        table.entries.push_back(make_entry(*material));
+        table.lookup.insert(make_pair(material->to_json().dump(), (uint32_t) i));
+        delete material;
+    }
+    return table;
+}
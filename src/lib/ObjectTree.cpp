@@ -13,36 +13,34 @@
  *   efficiently-searchable way. To facilitate moving spheres, the adding
  *   of the spheres is done in a dumb way, but with optimize() they are
  *   shuffled in the most optimal way.
- *   The most optimal way here is defined as //TBD
+ *   The tree itself is a flattened bounding volume hierarchy: all nodes
+ *   live in one contiguous vector in depth-first order, where the left
+ *   child of a branch always directly follows it and the right child is
+ *   found by offset. Leaves refer to a range of objects instead, which
+ *   are hit all at once with a SIMD kernel if they are spheres.
+ *   Optionally, the binary tree is collapsed into a wide tree with four
+ *   or eight children per node, whose child boxes are stored per
+ *   component so that all of them are hit by a ray at once.
 **/
 
 #include <limits>
 #include <iostream>
 #include <algorithm>
+#include <unordered_map>
+#ifdef THREADED
+#include <future>
+#endif
 
-#include <iostream>
+#if defined __AVX__ || defined __SSE2__ || defined __SSE__
+#include <immintrin.h>
+#endif
 
 #include "ObjectTree.hpp"
-#include "BoundingBox.hpp"
 
 using namespace std;
 using namespace RayTracer;
 
 
-void print_vec(string name, const vector<RenderObject*>& vec) {
-    cout << name << " {";
-    for (size_t i = 0; i < vec.size(); i++) {
-        if (i > 0) { cout << ", "; }
-        cout << vec.at(i);
-    }
-    cout << "}" << endl;
-}
-
-void print_bbox(string name, const BoundingBox& bbox) {
-    cout << name << " has size " << bbox.size() << endl;
-}
-
-
 /***** TOOLS *****/
 
 /* Sorting function for the x-axis. */
@@ -52,247 +50,327 @@ bool sort_y(RenderObject* obj_1, RenderObject* obj_2) { return obj_1->center.y <
 /* Sorting function for the z-axis. */
 bool sort_z(RenderObject* obj_1, RenderObject* obj_2) { return obj_1->center.z < obj_2->center.z; }
 
-/* Clusters a given list of RenderObjects into two new lists in such a way that each list is a cluster of objects that are closest to each other. */
-void cluster(const vector<RenderObject*>& total, vector<RenderObject*>& left, vector<RenderObject*>& right) {
-    // Nothing to be done if empty
-    if (total.size() == 0) { return; }
-
+/* Clusters the given range of RenderObjects in-place into two halves in such a way that each half is a cluster of objects that are closest to each other. Returns the iterator to the start of the second half. */
+vector<RenderObject*>::iterator cluster(vector<RenderObject*>::iterator begin, vector<RenderObject*>::iterator end) {
     // Sort according to the three axis'
-    vector<RenderObject*> ordered_x(total);
-    vector<RenderObject*> ordered_y(total);
-    vector<RenderObject*> ordered_z(total);
+    vector<RenderObject*> ordered_x(begin, end);
+    vector<RenderObject*> ordered_y(begin, end);
+    vector<RenderObject*> ordered_z(begin, end);
     sort(ordered_x.begin(), ordered_x.end(), sort_x);
     sort(ordered_y.begin(), ordered_y.end(), sort_y);
     sort(ordered_z.begin(), ordered_z.end(), sort_z);
 
     // For each of them, compute the largest boundingbox sizes
-    size_t const half_size = total.size() / 2;
+    size_t const total_size = ordered_x.size();
+    size_t const half_size = total_size / 2;
     BoundingBox bx1, bx2, by1, by2, bz1, bz2;
     for (size_t i = 0; i < half_size; i++) {
         bx1.merge(ordered_x.at(i)->box);
         by1.merge(ordered_y.at(i)->box);
         bz1.merge(ordered_z.at(i)->box);
     }
-    for (size_t i = half_size; i < total.size(); i++) {
+    for (size_t i = half_size; i < total_size; i++) {
         bx2.merge(ordered_x.at(i)->box);
         by2.merge(ordered_y.at(i)->box);
         bz2.merge(ordered_z.at(i)->box);
     }
 
-    // Set the splits with the smallest total BB
+    // Write back the split with the smallest total BB
     double sx = bx1.size() + bx2.size();
     double sy = by1.size() + by2.size();
     double sz = bz1.size() + bz2.size();
     if (sx <= sy && sx <= sz) {
         // x is smallest
-        vector<RenderObject*>::iterator halfway = ordered_x.begin() + half_size;
-        left = vector<RenderObject*>(ordered_x.begin(), halfway);
-        right = vector<RenderObject*>(halfway, ordered_x.end());
+        copy(ordered_x.begin(), ordered_x.end(), begin);
     } else if (sy <= sx && sy <= sz) {
         // y is smallest
-        vector<RenderObject*>::iterator halfway = ordered_y.begin() + half_size;
-        left = vector<RenderObject*>(ordered_y.begin(), halfway);
-        right = vector<RenderObject*>(halfway, ordered_y.end());
+        copy(ordered_y.begin(), ordered_y.end(), begin);
     } else {
         // z is smallest
-        vector<RenderObject*>::iterator halfway = ordered_z.begin() + half_size;
-        left = vector<RenderObject*>(ordered_z.begin(), halfway);
-        right = vector<RenderObject*>(halfway, ordered_z.end());
+        copy(ordered_z.begin(), ordered_z.end(), begin);
     }
+    return begin + half_size;
 }
 
-
-
-/***** OBJECT TREE BRANCH *****/
-
-ObjectTreeBranch::ObjectTreeBranch(const std::vector<RenderObject*> elements)
-    : ObjectTreeNode(false, BoundingBox())
-{
-    // First, construct the nodes by assigning them half each cluster
-    std::vector<RenderObject*> left;
-    std::vector<RenderObject*> right;
-    cluster(elements, left, right);
-    
-    // Construct leaves instead if only one element is left
-    if (left.size() == 1) {
-        this->left = (ObjectTreeNode*) new ObjectTreeLeaf(left.at(0));
-    } else {
-        this->left = (ObjectTreeNode*) new ObjectTreeBranch(left);
-    }
-    if (right.size() == 1) {
-        this->right = (ObjectTreeNode*) new ObjectTreeLeaf(right.at(0));
-    } else {
-        this->right = (ObjectTreeNode*) new ObjectTreeBranch(right);
+#ifdef THREADED
+/* Appends the nodes of a separately built subtree to the given list, relocating the offsets of its branches. */
+void splice(vector<ObjectTreeNode>& nodes, const vector<ObjectTreeNode>& subtree) {
+    uint32_t base = (uint32_t) nodes.size();
+    for (size_t i = 0; i < subtree.size(); i++) {
+        nodes.push_back(subtree[i]);
+        if (!subtree[i].is_leaf()) {
+            nodes.back().offset += base;
+        }
     }
-
-    // Update the bounding box to be a merge of those
-    this->box.merge(this->left->box);
-    this->box.merge(this->right->box);
-}
-
-ObjectTreeBranch::ObjectTreeBranch(const ObjectTreeBranch& other)
-    : ObjectTreeNode(false, other.box),
-    left(other.left->clone()),
-    right(other.right->clone())
-{}
-
-ObjectTreeBranch::ObjectTreeBranch(ObjectTreeBranch&& other)
-    : ObjectTreeNode(false, other.box),
-    left(other.left),
-    right(other.right)
-{
-    // Fill the other's nodes with nullptr
-    other.left = nullptr;
-    other.right = nullptr;
-}
-
-ObjectTreeBranch::~ObjectTreeBranch() {
-    // Delete the two children nodes
-    if (this->left != nullptr) { delete this->left; }
-    if (this->right != nullptr) { delete this->right; }
-}
-
-
-
-bool ObjectTreeBranch::quick_hit(const Ray& ray, double t_min, double t_max) const {
-    // Only check if the BB is hit
-    return this->box.hit(ray, t_min, t_max);
 }
-
-bool ObjectTreeBranch::hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const {
-    HitRecord record_r;
-    bool hit_left = this->left->quick_hit(ray, t_min, t_max) && this->left->hit(ray, t_min, t_max, record);
-    bool hit_right = this->right->quick_hit(ray, t_min, t_max) && this->right->hit(ray, t_min, t_max, record_r);
-    // Note the record if it was a hit
-    if (hit_left && hit_right) {
-        // Set record to the smallest one
-        if (record_r.t < record.t) {
-            record = record_r;
+#endif
+
+/* Hits given ray with all the children boxes of given wide node at once. Returns a bitmask of the children that are hit within (t_min, t_max), and stores the distance at which the ray enters each child in t_enter, which must be aligned to 32 bytes. This mirrors BoundingBox::hit(). */
+template <unsigned int W>
+unsigned int hit_children(const ObjectTreeWideNode<W>& node, const Ray& ray, scalar t_min, scalar t_max, scalar* t_enter) {
+    // By selecting the side of each box the ray enters through up front, we don't need to order the t's afterwards
+    const scalar* near_x = ray.sign[0] ? node.max_x : node.min_x;
+    const scalar* near_y = ray.sign[1] ? node.max_y : node.min_y;
+    const scalar* near_z = ray.sign[2] ? node.max_z : node.min_z;
+    const scalar* far_x = ray.sign[0] ? node.min_x : node.max_x;
+    const scalar* far_y = ray.sign[1] ? node.min_y : node.max_y;
+    const scalar* far_z = ray.sign[2] ? node.min_z : node.max_z;
+
+    unsigned int mask = 0;
+    #if defined FLOAT32 && defined __SSE__
+    __m128 ox = _mm_set1_ps(ray.origin.x), oy = _mm_set1_ps(ray.origin.y), oz = _mm_set1_ps(ray.origin.z);
+    __m128 ix = _mm_set1_ps(ray.inv_direction.x), iy = _mm_set1_ps(ray.inv_direction.y), iz = _mm_set1_ps(ray.inv_direction.z);
+    for (unsigned int i = 0; i < W; i += 4) {
+        // Note that max/min return their second argument on NaN, so a NaN t is ignored just like in BoundingBox::hit()
+        __m128 t0 = _mm_set1_ps(t_min);
+        __m128 t1 = _mm_set1_ps(t_max);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_x + i), ox), ix), t0);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_y + i), oy), iy), t0);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_z + i), oz), iz), t0);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_x + i), ox), ix), t1);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_y + i), oy), iy), t1);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_z + i), oz), iz), t1);
+        _mm_store_ps(t_enter + i, t0);
+        mask |= (unsigned int) _mm_movemask_ps(_mm_cmpgt_ps(t1, t0)) << i;
+    }
+    #elif defined __AVX__
+    __m256d ox = _mm256_set1_pd(ray.origin.x), oy = _mm256_set1_pd(ray.origin.y), oz = _mm256_set1_pd(ray.origin.z);
+    __m256d ix = _mm256_set1_pd(ray.inv_direction.x), iy = _mm256_set1_pd(ray.inv_direction.y), iz = _mm256_set1_pd(ray.inv_direction.z);
+    for (unsigned int i = 0; i < W; i += 4) {
+        // Note that max/min return their second argument on NaN, so a NaN t is ignored just like in BoundingBox::hit()
+        __m256d t0 = _mm256_set1_pd(t_min);
+        __m256d t1 = _mm256_set1_pd(t_max);
+        t0 = _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(near_x + i), ox), ix), t0);
+        t0 = _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(near_y + i), oy), iy), t0);
+        t0 = _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(near_z + i), oz), iz), t0);
+        t1 = _mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(far_x + i), ox), ix), t1);
+        t1 = _mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(far_y + i), oy), iy), t1);
+        t1 = _mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(far_z + i), oz), iz), t1);
+        _mm256_store_pd(t_enter + i, t0);
+        mask |= (unsigned int) _mm256_movemask_pd(_mm256_cmp_pd(t1, t0, _CMP_GT_OQ)) << i;
+    }
+    #elif defined __SSE2__
+    __m128d ox = _mm_set1_pd(ray.origin.x), oy = _mm_set1_pd(ray.origin.y), oz = _mm_set1_pd(ray.origin.z);
+    __m128d ix = _mm_set1_pd(ray.inv_direction.x), iy = _mm_set1_pd(ray.inv_direction.y), iz = _mm_set1_pd(ray.inv_direction.z);
+    for (unsigned int i = 0; i < W; i += 2) {
+        // Note that max/min return their second argument on NaN, so a NaN t is ignored just like in BoundingBox::hit()
+        __m128d t0 = _mm_set1_pd(t_min);
+        __m128d t1 = _mm_set1_pd(t_max);
+        t0 = _mm_max_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(near_x + i), ox), ix), t0);
+        t0 = _mm_max_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(near_y + i), oy), iy), t0);
+        t0 = _mm_max_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(near_z + i), oz), iz), t0);
+        t1 = _mm_min_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(far_x + i), ox), ix), t1);
+        t1 = _mm_min_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(far_y + i), oy), iy), t1);
+        t1 = _mm_min_pd(_mm_mul_pd(_mm_sub_pd(_mm_load_pd(far_z + i), oz), iz), t1);
+        _mm_store_pd(t_enter + i, t0);
+        mask |= (unsigned int) _mm_movemask_pd(_mm_cmpgt_pd(t1, t0)) << i;
+    }
+    #else
+    const scalar* near[3] = { near_x, near_y, near_z };
+    const scalar* far[3] = { far_x, far_y, far_z };
+    for (unsigned int i = 0; i < W; i++) {
+        scalar t0 = t_min;
+        scalar t1 = t_max;
+        for (int a = 0; a < 3; a++) {
+            scalar t_near = (near[a][i] - ray.origin.get(a)) * ray.inv_direction.get(a);
+            scalar t_far = (far[a][i] - ray.origin.get(a)) * ray.inv_direction.get(a);
+            t0 = t_near > t0 ? t_near : t0;
+            t1 = t_far < t1 ? t_far : t1;
         }
-    } else if (hit_right) {
-        // Don't forget to update record
-        record = record_r;
+        t_enter[i] = t0;
+        if (t1 > t0) { mask |= 1u << i; }
     }
-    
-    // Return if we actually hit
-    return hit_left || hit_right;
+    #endif
+    return mask;
 }
 
-
-
-ObjectTreeBranch& ObjectTreeBranch::operator=(ObjectTreeBranch other) {
-    // Copy the stuff by swapping
-    if (this != &other) {
-        // Copy by swapping
-        swap(*this, other);
+/* The rays of a packet, stored per component so that a box can be hit with several of them at once. */
+struct alignas(32) RayPacket {
+    /* The origins of the rays per component. */
+    scalar ox[OBJECTTREE_MAX_PACKET], oy[OBJECTTREE_MAX_PACKET], oz[OBJECTTREE_MAX_PACKET];
+    /* The inverse directions of the rays per component. */
+    scalar ix[OBJECTTREE_MAX_PACKET], iy[OBJECTTREE_MAX_PACKET], iz[OBJECTTREE_MAX_PACKET];
+    /* The distance to the closest hit so far per ray. Unused lanes are set to minus infinity, so that they never hit anything. */
+    scalar t_best[OBJECTTREE_MAX_PACKET];
+    /* The number of lanes in use, which is the number of rays rounded up to a multiple of four. */
+    unsigned int n_lanes;
+
+    /* Constructor for the RayPacket, which copies the given rays and pads the remaining lanes. */
+    RayPacket(const Ray* rays, unsigned int n, scalar t_max) {
+        this->n_lanes = (n + 3) / 4 * 4;
+        for (unsigned int i = 0; i < this->n_lanes; i++) {
+            if (i < n) {
+                this->ox[i] = rays[i].origin.x; this->oy[i] = rays[i].origin.y; this->oz[i] = rays[i].origin.z;
+                this->ix[i] = rays[i].inv_direction.x; this->iy[i] = rays[i].inv_direction.y; this->iz[i] = rays[i].inv_direction.z;
+                this->t_best[i] = t_max;
+            } else {
+                this->ox[i] = 0; this->oy[i] = 0; this->oz[i] = 0;
+                this->ix[i] = 1; this->iy[i] = 1; this->iz[i] = 1;
+                this->t_best[i] = -numeric_limits<scalar>::infinity();
+            }
+        }
     }
-    return *this;
-}
-ObjectTreeBranch& ObjectTreeBranch::operator=(ObjectTreeBranch&& other) {
-    // Copy the stuff directly
-    if (this != &other) {
-        this->left = other.left;
-        this->right = other.right;
-        other.left = nullptr;
-        other.right = nullptr;
+};
+
+/* Hits given box with all rays of given packet at once. Returns a bitmask of the rays that hit it within (t_min, t_best), and stores the distance at which each ray enters the box in t_enter, which must be aligned to 32 bytes. This mirrors BoundingBox::hit() per ray. */
+unsigned int hit_box(const BoundingBox& box, const RayPacket& packet, scalar t_min, scalar* t_enter) {
+    unsigned int mask = 0;
+    #if defined FLOAT32 && defined __SSE__
+    __m128 b1x = _mm_set1_ps(box.p1.x), b1y = _mm_set1_ps(box.p1.y), b1z = _mm_set1_ps(box.p1.z);
+    __m128 b2x = _mm_set1_ps(box.p2.x), b2y = _mm_set1_ps(box.p2.y), b2z = _mm_set1_ps(box.p2.z);
+    __m128 zero = _mm_setzero_ps();
+    for (unsigned int i = 0; i < packet.n_lanes; i += 4) {
+        __m128 ox = _mm_load_ps(packet.ox + i), oy = _mm_load_ps(packet.oy + i), oz = _mm_load_ps(packet.oz + i);
+        __m128 ix = _mm_load_ps(packet.ix + i), iy = _mm_load_ps(packet.iy + i), iz = _mm_load_ps(packet.iz + i);
+        // Rays with a negative direction enter through the upper side of the box, the others through the lower side
+        __m128 sx = _mm_cmplt_ps(ix, zero), sy = _mm_cmplt_ps(iy, zero), sz = _mm_cmplt_ps(iz, zero);
+        __m128 nx = _mm_or_ps(_mm_and_ps(sx, b2x), _mm_andnot_ps(sx, b1x)), fx = _mm_or_ps(_mm_and_ps(sx, b1x), _mm_andnot_ps(sx, b2x));
+        __m128 ny = _mm_or_ps(_mm_and_ps(sy, b2y), _mm_andnot_ps(sy, b1y)), fy = _mm_or_ps(_mm_and_ps(sy, b1y), _mm_andnot_ps(sy, b2y));
+        __m128 nz = _mm_or_ps(_mm_and_ps(sz, b2z), _mm_andnot_ps(sz, b1z)), fz = _mm_or_ps(_mm_and_ps(sz, b1z), _mm_andnot_ps(sz, b2z));
+
+        // Note that max/min return their second argument on NaN, so a NaN t is ignored just like in BoundingBox::hit()
+        __m128 t0 = _mm_set1_ps(t_min);
+        __m128 t1 = _mm_load_ps(packet.t_best + i);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(nx, ox), ix), t0);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(ny, oy), iy), t0);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(nz, oz), iz), t0);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(fx, ox), ix), t1);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(fy, oy), iy), t1);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(fz, oz), iz), t1);
+        _mm_store_ps(t_enter + i, t0);
+        mask |= (unsigned int) _mm_movemask_ps(_mm_cmpgt_ps(t1, t0)) << i;
     }
-    return *this;
-}
-
-
-
-ObjectTreeNode* ObjectTreeBranch::clone() const {
-    // Allocate a new tree leaf
-    return (ObjectTreeNode*) (new ObjectTreeBranch(*this));
-}
-
-
-
-/***** OBJECT TREE LEAF *****/
-
-ObjectTreeLeaf::ObjectTreeLeaf(RenderObject* obj)
-    : ObjectTreeNode(true, obj->box),
-    obj(obj)
-{}
-
-ObjectTreeLeaf::ObjectTreeLeaf(const ObjectTreeLeaf& other)
-    : ObjectTreeNode(true, obj->box),
-    obj(other.obj)
-{}
-
-ObjectTreeLeaf::ObjectTreeLeaf(ObjectTreeLeaf&& other)
-    : ObjectTreeNode(true, obj->box),
-    obj(other.obj)
-{}
-
-ObjectTreeLeaf::~ObjectTreeLeaf() {
-    // Nothing
-}
-
-
-bool ObjectTreeLeaf::quick_hit(const Ray& ray, double t_min, double t_max) const {
-    // Only check if the BB is hit
-    return this->obj->quick_hit(ray, t_min, t_max);
-}
-
-bool ObjectTreeLeaf::hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const {
-    // Check if the internal object has been hit
-    return this->obj->hit(ray, t_min, t_max, record);
-}
-
-
-
-ObjectTreeLeaf& ObjectTreeLeaf::operator=(ObjectTreeLeaf other) {
-    // Copy the stuff by swapping
-    if (this != &other) {
-        // Copy by swapping
-        swap(*this, other);
+    #elif defined __AVX__
+    __m256d b1x = _mm256_set1_pd(box.p1.x), b1y = _mm256_set1_pd(box.p1.y), b1z = _mm256_set1_pd(box.p1.z);
+    __m256d b2x = _mm256_set1_pd(box.p2.x), b2y = _mm256_set1_pd(box.p2.y), b2z = _mm256_set1_pd(box.p2.z);
+    for (unsigned int i = 0; i < packet.n_lanes; i += 4) {
+        __m256d ox = _mm256_load_pd(packet.ox + i), oy = _mm256_load_pd(packet.oy + i), oz = _mm256_load_pd(packet.oz + i);
+        __m256d ix = _mm256_load_pd(packet.ix + i), iy = _mm256_load_pd(packet.iy + i), iz = _mm256_load_pd(packet.iz + i);
+        // Rays with a negative direction enter through the upper side of the box; blendv selects on exactly that sign bit
+        __m256d nx = _mm256_blendv_pd(b1x, b2x, ix), fx = _mm256_blendv_pd(b2x, b1x, ix);
+        __m256d ny = _mm256_blendv_pd(b1y, b2y, iy), fy = _mm256_blendv_pd(b2y, b1y, iy);
+        __m256d nz = _mm256_blendv_pd(b1z, b2z, iz), fz = _mm256_blendv_pd(b2z, b1z, iz);
+
+        // Note that max/min return their second argument on NaN, so a NaN t is ignored just like in BoundingBox::hit()
+        __m256d t0 = _mm256_set1_pd(t_min);
+        __m256d t1 = _mm256_load_pd(packet.t_best + i);
+        t0 = _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(nx, ox), ix), t0);
+        t0 = _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(ny, oy), iy), t0);
+        t0 = _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(nz, oz), iz), t0);
+        t1 = _mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(fx, ox), ix), t1);
+        t1 = _mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(fy, oy), iy), t1);
+        t1 = _mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(fz, oz), iz), t1);
+        _mm256_store_pd(t_enter + i, t0);
+        mask |= (unsigned int) _mm256_movemask_pd(_mm256_cmp_pd(t1, t0, _CMP_GT_OQ)) << i;
     }
-    return *this;
-}
-ObjectTreeLeaf& ObjectTreeLeaf::operator=(ObjectTreeLeaf&& other) {
-    // Copy the stuff directly
-    if (this != &other) {
-        this->obj = other.obj;
-        other.obj = nullptr;
+    #elif defined __SSE2__
+    __m128d b1x = _mm_set1_pd(box.p1.x), b1y = _mm_set1_pd(box.p1.y), b1z = _mm_set1_pd(box.p1.z);
+    __m128d b2x = _mm_set1_pd(box.p2.x), b2y = _mm_set1_pd(box.p2.y), b2z = _mm_set1_pd(box.p2.z);
+    __m128d zero = _mm_setzero_pd();
+    for (unsigned int i = 0; i < packet.n_lanes; i += 2) {
+        __m128d ox = _mm_load_pd(packet.ox + i), oy = _mm_load_pd(packet.oy + i), oz = _mm_load_pd(packet.oz + i);
+        __m128d ix = _mm_load_pd(packet.ix + i), iy = _mm_load_pd(packet.iy + i), iz = _mm_load_pd(packet.iz + i);
+        // Rays with a negative direction enter through the upper side of the box, the others through the lower side
+        __m128d sx = _mm_cmplt_pd(ix, zero), sy = _mm_cmplt_pd(iy, zero), sz = _mm_cmplt_pd(iz, zero);
+        __m128d nx = _mm_or_pd(_mm_and_pd(sx, b2x), _mm_andnot_pd(sx, b1x)), fx = _mm_or_pd(_mm_and_pd(sx, b1x), _mm_andnot_pd(sx, b2x));
+        __m128d ny = _mm_or_pd(_mm_and_pd(sy, b2y), _mm_andnot_pd(sy, b1y)), fy = _mm_or_pd(_mm_and_pd(sy, b1y), _mm_andnot_pd(sy, b2y));
+        __m128d nz = _mm_or_pd(_mm_and_pd(sz, b2z), _mm_andnot_pd(sz, b1z)), fz = _mm_or_pd(_mm_and_pd(sz, b1z), _mm_andnot_pd(sz, b2z));
+
+        // Note that max/min return their second argument on NaN, so a NaN t is ignored just like in BoundingBox::hit()
+        __m128d t0 = _mm_set1_pd(t_min);
+        __m128d t1 = _mm_load_pd(packet.t_best + i);
+        t0 = _mm_max_pd(_mm_mul_pd(_mm_sub_pd(nx, ox), ix), t0);
+        t0 = _mm_max_pd(_mm_mul_pd(_mm_sub_pd(ny, oy), iy), t0);
+        t0 = _mm_max_pd(_mm_mul_pd(_mm_sub_pd(nz, oz), iz), t0);
+        t1 = _mm_min_pd(_mm_mul_pd(_mm_sub_pd(fx, ox), ix), t1);
+        t1 = _mm_min_pd(_mm_mul_pd(_mm_sub_pd(fy, oy), iy), t1);
+        t1 = _mm_min_pd(_mm_mul_pd(_mm_sub_pd(fz, oz), iz), t1);
+        _mm_store_pd(t_enter + i, t0);
+        mask |= (unsigned int) _mm_movemask_pd(_mm_cmpgt_pd(t1, t0)) << i;
     }
-    return *this;
+    #else
+    for (unsigned int i = 0; i < packet.n_lanes; i++) {
+        const scalar o[3] = { packet.ox[i], packet.oy[i], packet.oz[i] };
+        const scalar inv[3] = { packet.ix[i], packet.iy[i], packet.iz[i] };
+        scalar t0 = t_min;
+        scalar t1 = packet.t_best[i];
+        for (int a = 0; a < 3; a++) {
+            scalar t_near = ((inv[a] < 0 ? box.p2 : box.p1).get(a) - o[a]) * inv[a];
+            scalar t_far = ((inv[a] < 0 ? box.p1 : box.p2).get(a) - o[a]) * inv[a];
+            t0 = t_near > t0 ? t_near : t0;
+            t1 = t_far < t1 ? t_far : t1;
+        }
+        t_enter[i] = t0;
+        if (t1 > t0) { mask |= 1u << i; }
+    }
+    #endif
+    return mask;
 }
 
+/* Returns the smallest of the given distances of the rays in given mask. */
+scalar min_t_enter(const scalar* t_enter, unsigned int mask) {
+    scalar t = numeric_limits<scalar>::infinity();
+    for (unsigned int i = 0; mask != 0; i++, mask >>= 1) {
+        if ((mask & 1) && t_enter[i] < t) { t = t_enter[i]; }
+    }
+    return t;
+}
 
-
-ObjectTreeNode* ObjectTreeLeaf::clone() const {
-    // Allocate a new tree leaf
-    return (ObjectTreeNode*) (new ObjectTreeLeaf(*this));
+/* Returns the bin that given center falls in for a binned SAH split along one axis, where low is the lowest center on that axis and scale is n_bins divided by the extent of the centers. Both sorting the objects in bins and partitioning them afterwards use this, so that they always agree. */
+unsigned int sah_bin(scalar center, scalar low, scalar scale, unsigned int n_bins) {
+    unsigned int b = (unsigned int) ((center - low) * scale);
+    return b >= n_bins ? n_bins - 1 : b;
 }
 
 
+
 /***** OBJECT TREE *****/
 
 ObjectTree::ObjectTree()
-    : root(nullptr),
-    is_optimised(false),
-    uid(0)
+    : is_optimised(false),
+    uid(0),
+    built_cost(0)
 {}
 
 ObjectTree::ObjectTree(const ObjectTree& other)
-    : objects(other.objects),
-    root(other.root),
+    : nodes(other.nodes),
+    nodes4(other.nodes4),
+    nodes8(other.nodes8),
+    spheres(other.spheres),
     is_optimised(other.is_optimised),
-    uid(other.uid)
-{}
+    uid(other.uid),
+    options(other.options),
+    built_cost(other.built_cost)
+{
+    // Clone the objects, since the tree deletes its objects, and let the ordered list point to the clones in the same order
+    unordered_map<RenderObject*, RenderObject*> clones;
+    this->objects.reserve(other.objects.size());
+    for (size_t i = 0; i < other.objects.size(); i++) {
+        RenderObject* clone = other.objects[i]->clone();
+        this->objects.push_back(clone);
+        clones.insert(make_pair(other.objects[i], clone));
+    }
+    this->ordered.reserve(other.ordered.size());
+    for (size_t i = 0; i < other.ordered.size(); i++) {
+        this->ordered.push_back(clones.at(other.ordered[i]));
+    }
+}
 
 ObjectTree::ObjectTree(ObjectTree&& other)
     : objects(std::move(other.objects)),
-    root(std::move(other.root)),
+    ordered(std::move(other.ordered)),
+    nodes(std::move(other.nodes)),
+    nodes4(std::move(other.nodes4)),
+    nodes8(std::move(other.nodes8)),
+    spheres(std::move(other.spheres)),
     is_optimised(other.is_optimised),
-    uid(other.uid)
+    uid(other.uid),
+    options(other.options),
+    built_cost(other.built_cost)
 {}
 
 ObjectTree::~ObjectTree() {
-    if (this->root != nullptr) { delete this->root; }
-
-    // ALso delete all objects
+    // Delete all objects (the nodes clean themselves up)
     for (size_t i = 0; i < this->objects.size(); i++) {
         delete this->objects.at(i);
     }
@@ -331,43 +409,532 @@ bool ObjectTree::remove(RenderObject* obj) {
 
 
 
+void ObjectTree::set_options(const ObjectTreeOptions& options) {
+    this->options = options;
+    if (this->options.max_leaf_size < 1) { this->options.max_leaf_size = 1; }
+    if (this->options.width != 4 && this->options.width != 8) { this->options.width = 2; }
+
+    // The current tree was built with other options, so mark it as such
+    this->is_optimised = false;
+}
+
+const ObjectTreeOptions& ObjectTree::get_options() const {
+    return this->options;
+}
+
+
+
+size_t ObjectTree::split_sah(size_t start, size_t end, const BoundingBox& box) {
+    // The relative costs of traversing a node and of hitting an object
+    const double cost_traversal = 1.0;
+    const double cost_hit = 1.0;
+
+    // First, compute the bounds of the centers, as that is what we bin on
+    Vec3 c_min = this->ordered.at(start)->center;
+    Vec3 c_max = c_min;
+    for (size_t i = start + 1; i < end; i++) {
+        const Vec3& c = this->ordered.at(i)->center;
+        for (int a = 0; a < 3; a++) {
+            if (c.get(a) < c_min.get(a)) { c_min[a] = c.get(a); }
+            if (c.get(a) > c_max.get(a)) { c_max[a] = c.get(a); }
+        }
+    }
+
+    // Find the cheapest split over all axis' and bin boundaries
+    unsigned int n_bins = this->options.n_bins < 2 ? 2 : this->options.n_bins;
+    vector<size_t> bin_count(n_bins);
+    vector<BoundingBox> bin_box(n_bins);
+    vector<double> right_cost(n_bins);
+    double best_cost = numeric_limits<double>::max();
+    int best_axis = -1;
+    unsigned int best_bin = 0;
+    scalar best_scale = 0;
+    for (int a = 0; a < 3; a++) {
+        scalar extent = c_max.get(a) - c_min.get(a);
+        if (extent <= 0) { continue; }
+        scalar scale = n_bins / extent;
+
+        // Sort the objects in the bins
+        fill(bin_count.begin(), bin_count.end(), 0);
+        for (size_t i = start; i < end; i++) {
+            RenderObject* obj = this->ordered.at(i);
+            unsigned int b = sah_bin(obj->center.get(a), c_min.get(a), scale, n_bins);
+            if (bin_count[b] == 0) {
+                bin_box[b] = obj->box;
+            } else {
+                bin_box[b].merge(obj->box);
+            }
+            bin_count[b]++;
+        }
+
+        // Sweep from the right to compute the cost of everything right of each boundary
+        BoundingBox acc;
+        size_t n_acc = 0;
+        for (unsigned int b = n_bins - 1; b > 0; b--) {
+            if (bin_count[b] > 0) {
+                if (n_acc == 0) { acc = bin_box[b]; } else { acc.merge(bin_box[b]); }
+                n_acc += bin_count[b];
+            }
+            right_cost[b] = n_acc == 0 ? 0 : acc.surface() * n_acc;
+        }
+
+        // Sweep from the left and combine; a split at b puts bins [0, b) to the left
+        n_acc = 0;
+        for (unsigned int b = 1; b < n_bins; b++) {
+            if (bin_count[b - 1] > 0) {
+                if (n_acc == 0) { acc = bin_box[b - 1]; } else { acc.merge(bin_box[b - 1]); }
+                n_acc += bin_count[b - 1];
+            }
+            if (n_acc == 0 || n_acc == end - start) { continue; }
+
+            double cost = acc.surface() * n_acc + right_cost[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = a;
+                best_bin = b;
+                best_scale = scale;
+            }
+        }
+    }
+
+    // If all centers coincide, we cannot bin; let the caller decide
+    if (best_axis < 0) { return end; }
+
+    // Compare the expected cost of the split with that of a leaf
+    double area = box.surface();
+    size_t n = end - start;
+    double split_cost = area > 0 ? cost_traversal + cost_hit * best_cost / area : cost_traversal + cost_hit * n;
+    if (n <= this->options.max_leaf_size && cost_hit * n <= split_cost) {
+        return end;
+    }
+
+    // Partition the range according to the chosen split
+    scalar c_low = c_min.get(best_axis);
+    vector<RenderObject*>::iterator split = partition(this->ordered.begin() + start, this->ordered.begin() + end, [best_axis, best_bin, best_scale, n_bins, c_low](RenderObject* obj) {
+        return sah_bin(obj->center.get(best_axis), c_low, best_scale, n_bins) < best_bin;
+    });
+    return split - this->ordered.begin();
+}
+
+uint32_t ObjectTree::build(vector<ObjectTreeNode>& nodes, size_t start, size_t end, unsigned int depth) {
+    // Reserve the node for this range first, so that it precedes its children
+    uint32_t index = (uint32_t) nodes.size();
+    nodes.push_back(ObjectTreeNode());
+
+    // Compute the box of the entire range
+    BoundingBox box = this->ordered.at(start)->box;
+    for (size_t i = start + 1; i < end; i++) {
+        box.merge(this->ordered.at(i)->box);
+    }
+    nodes[index].box = box;
+
+    // Find where to split the range
+    size_t n = end - start;
+    size_t split = end;
+    if (n > 1) {
+        // Only use the SAH while there is stack room left; the median split is guaranteed to halve the depth
+        if (this->options.strategy == binned_sah && depth < OBJECTTREE_STACK_SIZE / 2) {
+            split = this->split_sah(start, end, box);
+            if (split == end && n > this->options.max_leaf_size) {
+                // The SAH refused, but the range is too large for a leaf
+                split = cluster(this->ordered.begin() + start, this->ordered.begin() + end) - this->ordered.begin();
+            }
+        } else if (n > this->options.max_leaf_size) {
+            split = cluster(this->ordered.begin() + start, this->ordered.begin() + end) - this->ordered.begin();
+        }
+    }
+
+    if (split == end) {
+        // No split, so make a leaf
+        nodes[index].offset = (uint32_t) start;
+        nodes[index].n_objects = (uint32_t) n;
+        return index;
+    }
+
+    // Otherwise, build the children in depth-first order
+    uint32_t right;
+    #ifdef THREADED
+    if (n >= OBJECTTREE_PARALLEL_THRESHOLD && depth < 32 && (1u << depth) < this->options.n_threads) {
+        // Build the left subtree on another core while we do the right one. Both are built into their own list and then
+        //   spliced in depth-first order, so the result is the same as a serial build.
+        vector<ObjectTreeNode> left_nodes, right_nodes;
+        future<uint32_t> left_task = async(launch::async, &ObjectTree::build, this, ref(left_nodes), start, split, depth + 1);
+        this->build(right_nodes, split, end, depth + 1);
+        left_task.get();
+
+        splice(nodes, left_nodes);
+        right = (uint32_t) nodes.size();
+        splice(nodes, right_nodes);
+    } else {
+        this->build(nodes, start, split, depth + 1);
+        right = this->build(nodes, split, end, depth + 1);
+    }
+    #else
+    this->build(nodes, start, split, depth + 1);
+    right = this->build(nodes, split, end, depth + 1);
+    #endif
+
+    // Note that the vector may have been reallocated, so index again
+    nodes[index].offset = right;
+    nodes[index].n_objects = 0;
+    return index;
+}
+
+template <unsigned int W>
+uint32_t ObjectTree::collapse(vector<ObjectTreeWideNode<W>>& wide, uint32_t index) const {
+    uint32_t w = (uint32_t) wide.size();
+    wide.push_back(ObjectTreeWideNode<W>());
+
+    // Start with the children of the binary node (or the node itself if the whole tree is one leaf)
+    uint32_t children[W];
+    unsigned int n = 0;
+    if (this->nodes[index].is_leaf()) {
+        children[n++] = index;
+    } else {
+        children[n++] = index + 1;
+        children[n++] = this->nodes[index].offset;
+    }
+
+    // Keep opening the child branch with the largest surface, as that is the one most likely to be hit, until the node is full
+    while (n < W) {
+        int largest = -1;
+        double largest_surface = -1;
+        for (unsigned int i = 0; i < n; i++) {
+            const ObjectTreeNode& child = this->nodes[children[i]];
+            if (!child.is_leaf() && child.box.surface() > largest_surface) {
+                largest = (int) i;
+                largest_surface = child.box.surface();
+            }
+        }
+        if (largest < 0) { break; }
+
+        // Replace it with its left child and put its right child directly behind it, to keep the children in tree order
+        uint32_t opened = children[largest];
+        for (unsigned int i = n; i > (unsigned int) largest + 1; i--) {
+            children[i] = children[i - 1];
+        }
+        children[largest] = opened + 1;
+        children[largest + 1] = this->nodes[opened].offset;
+        n++;
+    }
+
+    // Write the children, recursing into the branches. Note that the vector may be reallocated by that, so index again every time
+    for (unsigned int i = 0; i < W; i++) {
+        uint32_t offset = 0, n_objects = 0;
+        if (i < n) {
+            const ObjectTreeNode& child = this->nodes[children[i]];
+            if (child.is_leaf()) {
+                offset = child.offset;
+                n_objects = child.n_objects;
+            } else {
+                offset = this->collapse(wide, children[i]);
+            }
+        }
+
+        ObjectTreeWideNode<W>& node = wide[w];
+        if (i < n) {
+            const BoundingBox& box = this->nodes[children[i]].box;
+            node.min_x[i] = box.p1.x; node.min_y[i] = box.p1.y; node.min_z[i] = box.p1.z;
+            node.max_x[i] = box.p2.x; node.max_y[i] = box.p2.y; node.max_z[i] = box.p2.z;
+        } else {
+            // An inverted, infinite box is never hit
+            scalar inf = numeric_limits<scalar>::infinity();
+            node.min_x[i] = inf; node.min_y[i] = inf; node.min_z[i] = inf;
+            node.max_x[i] = -inf; node.max_y[i] = -inf; node.max_z[i] = -inf;
+        }
+        node.offset[i] = offset;
+        node.n_objects[i] = n_objects;
+    }
+    wide[w].n_children = n;
+    return w;
+}
+
+void ObjectTree::collapse_all() {
+    this->nodes4.clear();
+    this->nodes8.clear();
+    if (this->nodes.empty()) { return; }
+
+    if (this->options.width == 4) {
+        this->collapse(this->nodes4, 0);
+    } else if (this->options.width == 8) {
+        this->collapse(this->nodes8, 0);
+    }
+}
+
 void ObjectTree::optimize() {
     this->is_optimised = true;
 
     // Start by removing any existing trees
-    if (this->root != nullptr) {
-        delete this->root;
-    }
+    this->nodes.clear();
+    this->nodes4.clear();
+    this->nodes8.clear();
     
     // Make sure there are things to optimize
     if (this->size() == 0) { return; }
 
-    // Create the root node
-    if (this->size() == 1) {
-        // If there is only one element, make a leaf
-        this->root = (ObjectTreeNode*) new ObjectTreeLeaf(this->objects.at(0));
-    } else {
-        // Else, make a branch which splits itself
-        this->root = (ObjectTreeNode*) new ObjectTreeBranch(this->objects);
+    // A binary tree with one object per leaf has exactly 2n - 1 nodes
+    this->nodes.reserve(2 * this->size() - 1);
+    this->ordered = this->objects;
+    this->build(this->nodes, 0, this->ordered.size(), 0);
+    this->spheres.update(this->ordered);
+    this->built_cost = this->cost();
+    this->collapse_all();
+}
+
+bool ObjectTree::refit() {
+    // We can only refit a tree that still matches the objects
+    if (!this->is_optimised || this->nodes.empty()) {
+        this->optimize();
+        return false;
+    }
+
+    // The spheres might have moved as well
+    this->spheres.update(this->ordered);
+
+    // Children are always stored after their parents, so walking backwards visits them first
+    for (size_t i = this->nodes.size(); i-- > 0;) {
+        ObjectTreeNode& node = this->nodes[i];
+        if (node.is_leaf()) {
+            node.box = this->ordered[node.offset]->box;
+            for (uint32_t j = node.offset + 1; j < node.offset + node.n_objects; j++) {
+                node.box.merge(this->ordered[j]->box);
+            }
+        } else {
+            node.box = this->nodes[i + 1].box;
+            node.box.merge(this->nodes[node.offset].box);
+        }
+    }
+
+    // If the boxes grew too much in the process, start over
+    if (this->cost() > this->options.rebuild_threshold * this->built_cost) {
+        this->optimize();
+        return false;
+    }
+
+    // The wide tree has its own copies of the boxes, so simply collapse the refitted tree again
+    this->collapse_all();
+    return true;
+}
+
+double ObjectTree::cost() const {
+    if (this->nodes.empty()) { return 0; }
+
+    // Every node is visited with a probability relative to its surface, and then costs a traversal step or its object hits
+    double root_area = this->nodes[0].box.surface();
+    if (root_area <= 0) { return 0; }
+    double total = 0;
+    for (size_t i = 0; i < this->nodes.size(); i++) {
+        const ObjectTreeNode& node = this->nodes[i];
+        total += node.box.surface() / root_area * (node.is_leaf() ? node.n_objects : 1);
+    }
+    return total;
+}
+
+
+
+bool ObjectTree::hit_leaf(uint32_t offset, uint32_t n_objects, const Ray& ray, scalar t_min, scalar& t_best, HitRecord& record) const {
+    bool hit = false;
+    if (n_objects > 1) {
+        // Let the SIMD kernel find the closest sphere, and then only let that one fill in the record
+        size_t index;
+        scalar t;
+        if (this->spheres.hit(ray, offset, n_objects, t_min, t_best, index, t)) {
+            if (this->ordered[index]->hit(ray, t_min, t_best, record)) {
+                t_best = record.t;
+                record.material = this->spheres.material[index];
+                hit = true;
+            } else {
+                // The kernel disagrees with the sphere on the last bits, so play it safe and try all spheres
+                for (uint32_t i = offset; i < offset + n_objects; i++) {
+                    if (this->spheres.is_sphere(i) && this->ordered[i]->hit(ray, t_min, t_best, record)) {
+                        t_best = record.t;
+                        record.material = this->spheres.material[i];
+                        hit = true;
+                    }
+                }
+            }
+        }
+
+        // Any objects that aren't spheres are hit separately
+        if (this->spheres.has_others()) {
+            for (uint32_t i = offset; i < offset + n_objects; i++) {
+                RenderObject* obj = this->ordered[i];
+                if (!this->spheres.is_sphere(i) && obj->quick_hit(ray, t_min, t_best) && obj->hit(ray, t_min, t_best, record)) {
+                    t_best = record.t;
+                    hit = true;
+                }
+            }
+        }
+        return hit;
+    }
+
+    // For a single object, its box equals the node box so we can go straight to the object
+    if (this->ordered[offset]->hit(ray, t_min, t_best, record)) {
+        t_best = record.t;
+        hit = true;
+    }
+    return hit;
+}
+
+bool ObjectTree::hit_unordered(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const {
+    // Traverse the tree iteratively using a small, fixed stack of node indices
+    uint32_t stack[OBJECTTREE_STACK_SIZE];
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    scalar t_best = t_max;
+    bool hit = false;
+    while (stack_size > 0) {
+        uint32_t index = stack[--stack_size];
+        const ObjectTreeNode& node = this->nodes[index];
+
+        // Skip the whole subtree if its box is missed (or further away than the best hit so far)
+        if (!node.box.hit(ray, t_min, t_best)) { continue; }
+
+        if (node.is_leaf()) {
+            hit |= this->hit_leaf(node.offset, node.n_objects, ray, t_min, t_best, record);
+        } else {
+            // Push the right child first so that the left child is popped (and thus read from memory) next
+            stack[stack_size++] = node.offset;
+            stack[stack_size++] = index + 1;
+        }
+    }
+
+    return hit;
+}
+
+bool ObjectTree::hit_ordered(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const {
+    // Every stack entry remembers where its box was entered, so it can be skipped if a closer hit is found in the meantime
+    struct StackEntry {
+        uint32_t index;
+        scalar t_enter;
+    };
+    StackEntry stack[OBJECTTREE_STACK_SIZE];
+    size_t stack_size = 0;
+
+    // Only the root box is tested here; children are tested before they are pushed
+    scalar t_enter;
+    if (!this->nodes[0].box.hit(ray, t_min, t_max, t_enter)) { return false; }
+    stack[stack_size++] = { 0, t_enter };
+
+    scalar t_best = t_max;
+    bool hit = false;
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if (entry.t_enter >= t_best) { continue; }
+        uint32_t index = entry.index;
+        const ObjectTreeNode& node = this->nodes[index];
+
+        if (node.is_leaf()) {
+            hit |= this->hit_leaf(node.offset, node.n_objects, ray, t_min, t_best, record);
+            continue;
+        }
+
+        // Test both children against the closest hit so far
+        scalar t_left, t_right;
+        bool hit_left = this->nodes[index + 1].box.hit(ray, t_min, t_best, t_left);
+        bool hit_right = this->nodes[node.offset].box.hit(ray, t_min, t_best, t_right);
+        if (hit_left && hit_right) {
+            // Push the far child first, so that the near one is visited first
+            if (t_left <= t_right) {
+                stack[stack_size++] = { node.offset, t_right };
+                stack[stack_size++] = { index + 1, t_left };
+            } else {
+                stack[stack_size++] = { index + 1, t_left };
+                stack[stack_size++] = { node.offset, t_right };
+            }
+        } else if (hit_left) {
+            stack[stack_size++] = { index + 1, t_left };
+        } else if (hit_right) {
+            stack[stack_size++] = { node.offset, t_right };
+        }
     }
+
+    return hit;
 }
 
+template <unsigned int W>
+bool ObjectTree::hit_wide(const vector<ObjectTreeWideNode<W>>& wide, const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const {
+    // Stack entries are either a wide node (n_objects is 0) or a leaf range, together with where their box was entered
+    struct StackEntry {
+        uint32_t offset;
+        uint32_t n_objects;
+        scalar t_enter;
+    };
+    // Every level of the tree adds at most W - 1 entries to the stack, and the tree is never deeper than the binary one
+    StackEntry stack[OBJECTTREE_STACK_SIZE * (OBJECTTREE_MAX_WIDTH - 1)];
+    size_t stack_size = 0;
+
+    // The root has no box of its own; its children are tested when it is visited
+    stack[stack_size++] = { 0, 0, t_min };
+
+    alignas(32) scalar t_enter[W];
+    scalar t_best = t_max;
+    bool hit = false;
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if (entry.t_enter >= t_best) { continue; }
 
+        if (entry.n_objects > 0) {
+            hit |= this->hit_leaf(entry.offset, entry.n_objects, ray, t_min, t_best, record);
+            continue;
+        }
 
-bool ObjectTree::hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const {
+        // Test all children against the closest hit so far in one go
+        const ObjectTreeWideNode<W>& node = wide[entry.offset];
+        unsigned int mask = hit_children<W>(node, ray, t_min, t_best, t_enter);
+        if (mask == 0) { continue; }
+
+        if (this->options.ordered_traversal) {
+            // Sort the hit children from far to near, so that the nearest is pushed last and thus visited first
+            StackEntry hits[W];
+            unsigned int n_hits = 0;
+            for (unsigned int i = 0; i < W; i++) {
+                if (!(mask & (1u << i))) { continue; }
+                StackEntry child = { node.offset[i], node.n_objects[i], t_enter[i] };
+                unsigned int j = n_hits++;
+                for (; j > 0 && hits[j - 1].t_enter < child.t_enter; j--) {
+                    hits[j] = hits[j - 1];
+                }
+                hits[j] = child;
+            }
+            for (unsigned int i = 0; i < n_hits; i++) {
+                stack[stack_size++] = hits[i];
+            }
+        } else {
+            // Push in reverse, so that the first child is visited first
+            for (unsigned int i = W; i-- > 0;) {
+                if (mask & (1u << i)) {
+                    stack[stack_size++] = { node.offset[i], node.n_objects[i], t_enter[i] };
+                }
+            }
+        }
+    }
+
+    return hit;
+}
+
+bool ObjectTree::hit(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const {
     // Do different things depending if we're optimised or not
     if (this->is_optimised) {
         // Quit if there is nothing
-        if (this->root == nullptr) { return false; }
-
-        // Simply use the tree structure
-        return this->root->quick_hit(ray, t_min, t_max) && this->root->hit(ray, t_min, t_max, record);
+        if (this->nodes.empty()) { return false; }
+
+        // Otherwise, walk the tree of the chosen width in the chosen order
+        if (this->options.width == 4) {
+            return this->hit_wide(this->nodes4, ray, t_min, t_max, record);
+        } else if (this->options.width == 8) {
+            return this->hit_wide(this->nodes8, ray, t_min, t_max, record);
+        } else if (this->options.ordered_traversal) {
+            return this->hit_ordered(ray, t_min, t_max, record);
+        }
+        return this->hit_unordered(ray, t_min, t_max, record);
     }
 
     cerr << "WARNING: ObjectTree @ " << this << " is not optimised." << endl;
 
     // Otherwise, do it loop-wise
-    double t_best = t_max;
+    scalar t_best = t_max;
     bool hit = false;
     for (size_t i = 0; i < this->objects.size(); i++) {
         // Fetch the correct item from the list
@@ -382,6 +949,87 @@ bool ObjectTree::hit(const Ray& ray, double t_min, double t_max, HitRecord& reco
     return hit;
 }
 
+void ObjectTree::hit_packet(const Ray* rays, unsigned int n, scalar t_min, scalar t_max, HitRecord* records, bool* hits) const {
+    // The packet only has room for OBJECTTREE_MAX_PACKET rays, so trace larger inputs in chunks of that size
+    if (n > OBJECTTREE_MAX_PACKET) {
+        for (unsigned int i = 0; i < n; i += OBJECTTREE_MAX_PACKET) {
+            unsigned int chunk = n - i < OBJECTTREE_MAX_PACKET ? n - i : OBJECTTREE_MAX_PACKET;
+            this->hit_packet(rays + i, chunk, t_min, t_max, records + i, hits + i);
+        }
+        return;
+    }
+
+    // Without a tree there's nothing to share, so then simply hit the rays one by one
+    if (!this->is_optimised || this->nodes.empty() || n <= 1) {
+        for (unsigned int i = 0; i < n; i++) {
+            hits[i] = this->hit(rays[i], t_min, t_max, records[i]);
+        }
+        return;
+    }
+
+    // Every stack entry remembers which rays hit its box and where the first of them entered it
+    struct StackEntry {
+        uint32_t index;
+        uint32_t mask;
+        scalar t_enter;
+    };
+    StackEntry stack[OBJECTTREE_STACK_SIZE];
+    size_t stack_size = 0;
+
+    RayPacket packet(rays, n, t_max);
+    alignas(32) scalar t_enter[OBJECTTREE_MAX_PACKET];
+    for (unsigned int i = 0; i < n; i++) {
+        hits[i] = false;
+    }
+
+    // Only the root box is tested here; children are tested before they are pushed
+    unsigned int mask = hit_box(this->nodes[0].box, packet, t_min, t_enter);
+    if (mask == 0) { return; }
+    stack[stack_size++] = { 0, mask, min_t_enter(t_enter, mask) };
+
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+
+        // Drop the rays that found a hit before the box since it was pushed
+        mask = entry.mask;
+        for (unsigned int i = 0; i < n; i++) {
+            if ((mask & (1u << i)) && packet.t_best[i] <= entry.t_enter) { mask &= ~(1u << i); }
+        }
+        if (mask == 0) { continue; }
+
+        const ObjectTreeNode& node = this->nodes[entry.index];
+        if (node.is_leaf()) {
+            for (unsigned int i = 0; i < n; i++) {
+                if (mask & (1u << i)) {
+                    hits[i] |= this->hit_leaf(node.offset, node.n_objects, rays[i], t_min, packet.t_best[i], records[i]);
+                }
+            }
+            continue;
+        }
+
+        // Test both children with all rays that are still interested in this node
+        unsigned int mask_left = hit_box(this->nodes[entry.index + 1].box, packet, t_min, t_enter) & mask;
+        scalar t_left = min_t_enter(t_enter, mask_left);
+        unsigned int mask_right = hit_box(this->nodes[node.offset].box, packet, t_min, t_enter) & mask;
+        scalar t_right = min_t_enter(t_enter, mask_right);
+
+        // Push the far child first, so that the near one is visited first
+        if (mask_left != 0 && mask_right != 0) {
+            if (t_left <= t_right) {
+                stack[stack_size++] = { node.offset, mask_right, t_right };
+                stack[stack_size++] = { entry.index + 1, mask_left, t_left };
+            } else {
+                stack[stack_size++] = { entry.index + 1, mask_left, t_left };
+                stack[stack_size++] = { node.offset, mask_right, t_right };
+            }
+        } else if (mask_left != 0) {
+            stack[stack_size++] = { entry.index + 1, mask_left, t_left };
+        } else if (mask_right != 0) {
+            stack[stack_size++] = { node.offset, mask_right, t_right };
+        }
+    }
+}
+
 
 
 ObjectTree& ObjectTree::operator=(ObjectTree other) {
@@ -414,27 +1062,25 @@ RenderObject* ObjectTree::operator[](size_t index) {
 size_t ObjectTree::size() const {
     return this->objects.size();
 }
+size_t ObjectTree::n_nodes() const {
+    return this->nodes.size();
+}
 
 
 
 /***** SWAP OPERATORS *****/
 
-void RayTracer::swap(ObjectTreeBranch& first, ObjectTreeBranch& second) {
-    using std::swap;
-
-    swap(first.left, second.left);
-    swap(first.right, second.right);
-}
-void RayTracer::swap(ObjectTreeLeaf& first, ObjectTreeLeaf& second) {
-    using std::swap;
-
-    swap(first.obj, second.obj);
-}
 void RayTracer::swap(ObjectTree& first, ObjectTree& second) {
     using std::swap;
 
     swap(first.objects, second.objects);
-    swap(first.root, second.root);
+    swap(first.ordered, second.ordered);
+    swap(first.nodes, second.nodes);
+    swap(first.nodes4, second.nodes4);
+    swap(first.nodes8, second.nodes8);
+    swap(first.spheres, second.spheres);
     swap(first.is_optimised, second.is_optimised);
     swap(first.uid, second.uid);
+    swap(first.options, second.options);
+    swap(first.built_cost, second.built_cost);
 }
\ No newline at end of file
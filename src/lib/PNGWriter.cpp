@@ -0,0 +1,231 @@
+/* PNG WRITER.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 22:04:23
+ * Last edited:
+ *   18/10/2026, 22:04:23
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   Writes Images to PNG files. The image is cut into bands of rows,
+ *   which are converted to bytes, filtered and compressed independently
+ *   of each other, so that they can be spread over multiple threads if
+ *   compiled with THREADED. Every band ends with a zlib sync flush, which
+ *   lets the bands be concatenated into one valid deflate stream. The
+ *   bands are written to the file in order as soon as they are done.
+ *   This particular file is the implementation file for PNGWriter.hpp.
+**/
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+#ifdef THREADED
+#include <deque>
+#include <future>
+#endif
+#include <zlib.h>
+
+#include "Image.hpp"
+#include "PNGWriter.hpp"
+
+using namespace std;
+using namespace RayTracer;
+
+
+/* One band of rows of the image, compressed and ready to be written. */
+struct PNGBand {
+    /* The raw deflate data of the band. */
+    vector<unsigned char> data;
+    /* The Adler-32 checksum of the uncompressed (but filtered) band. */
+    uLong adler;
+    /* The number of uncompressed bytes in the band. */
+    size_t length;
+};
+
+/* Writes given value to the four bytes at out, most significant byte first. */
+static void put_uint32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char) (value >> 24);
+    out[1] = (unsigned char) (value >> 16);
+    out[2] = (unsigned char) (value >> 8);
+    out[3] = (unsigned char) value;
+}
+
+/* Writes a PNG chunk with given type and data to the file. */
+static void write_chunk(ofstream& file, const char* type, const unsigned char* data, size_t length) {
+    unsigned char header[8];
+    put_uint32(header, (uint32_t) length);
+    memcpy(header + 4, type, 4);
+
+    // The checksum covers both the type and the data
+    unsigned char footer[4];
+    uLong crc = crc32(0L, (const Bytef*) type, 4);
+    if (length > 0) {
+        crc = crc32(crc, data, (uInt) length);
+    }
+    put_uint32(footer, (uint32_t) crc);
+
+    file.write((const char*) header, 8);
+    file.write((const char*) data, length);
+    file.write((const char*) footer, 4);
+}
+
+/* Applies the Paeth filter to the row in cur, given the row above it in prev. The result is written to out, preceded by the filter type. */
+static void filter_row(const unsigned char* cur, const unsigned char* prev, size_t stride, unsigned char* out) {
+    out[0] = 4;
+    for (size_t i = 0; i < stride; i++) {
+        // Predict the byte from its left (a), upper (b) and upper-left (c) neighbours, and store only the difference
+        int a = i >= 3 ? cur[i - 3] : 0;
+        int b = prev[i];
+        int c = i >= 3 ? prev[i - 3] : 0;
+        int p = a + b - c;
+        int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        int predicted = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        out[i + 1] = (unsigned char) (cur[i] - predicted);
+    }
+}
+
+/* Feeds n bytes to the deflate stream, writing the result after the first used bytes of out and growing it if needed. */
+static void deflate_into(z_stream& stream, const unsigned char* in, size_t n, int flush, vector<unsigned char>& out, size_t& used) {
+    stream.next_in = (Bytef*) in;
+    stream.avail_in = (uInt) n;
+    do {
+        if (used == out.size()) {
+            out.resize(2 * out.size() + 1024);
+        }
+        stream.next_out = out.data() + used;
+        stream.avail_out = (uInt) (out.size() - used);
+        if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+            throw runtime_error("Could not compress image data");
+        }
+        used = out.size() - stream.avail_out;
+    } while (stream.avail_out == 0);
+}
+
+/* Converts, filters and compresses the rows [y1, y2) of the image. The last band ends the deflate stream, while the others end with a sync flush so that the next band can follow them directly. */
+static PNGBand encode_band(const Image& image, unsigned int y1, unsigned int y2, int level, bool last) {
+    size_t stride = 3 * (size_t) image.width;
+    vector<unsigned char> prev(stride, 0), cur(stride), filtered(stride + 1);
+    if (y1 > 0) {
+        // The filter looks at the row above, even if that's in another band
+        image.row_to_bytes(y1 - 1, prev.data());
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw runtime_error("Could not initialise zlib");
+    }
+
+    PNGBand band;
+    band.adler = adler32(0L, Z_NULL, 0);
+    band.length = 0;
+    band.data.resize(deflateBound(&stream, (y2 - y1) * filtered.size()) + 16);
+    size_t used = 0;
+    try {
+        for (unsigned int y = y1; y < y2; y++) {
+            image.row_to_bytes(y, cur.data());
+            filter_row(cur.data(), prev.data(), stride, filtered.data());
+            band.adler = adler32(band.adler, filtered.data(), (uInt) filtered.size());
+            band.length += filtered.size();
+
+            int flush = y + 1 < y2 ? Z_NO_FLUSH : (last ? Z_FINISH : Z_SYNC_FLUSH);
+            deflate_into(stream, filtered.data(), filtered.size(), flush, band.data, used);
+            swap(prev, cur);
+        }
+    } catch (runtime_error&) {
+        deflateEnd(&stream);
+        throw;
+    }
+    deflateEnd(&stream);
+
+    band.data.resize(used);
+    return band;
+}
+
+
+
+void RayTracer::write_png(const Image& image, const std::string& path, const PNGOptions& options) {
+    ofstream file(path, ios::binary);
+    if (!file.is_open()) {
+        throw runtime_error("Could not open '" + path + "' for writing");
+    }
+
+    // Write the signature and the header, which says we store 8-bit RGB without interlacing
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    file.write((const char*) signature, 8);
+    unsigned char ihdr[13];
+    put_uint32(ihdr, image.width);
+    put_uint32(ihdr + 4, image.height);
+    ihdr[8] = 8;
+    ihdr[9] = 2;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    write_chunk(file, "IHDR", ihdr, 13);
+
+    // The deflate stream of the bands is wrapped in a zlib stream, whose header tells the compression level (0-3) and has a checksum
+    int level = min(max(options.level, 0), 9);
+    unsigned int flevel = level <= 1 ? 0 : (level <= 5 ? 1 : (level == 6 ? 2 : 3));
+    unsigned char zlib_header[2] = { 0x78, (unsigned char) (flevel << 6) };
+    zlib_header[1] += (31 - (zlib_header[0] * 256 + zlib_header[1]) % 31) % 31;
+
+    // Every band is written as its own IDAT chunk, with the zlib header and trailer added to the first and last one
+    size_t row_size = 3 * (size_t) image.width + 1;
+    unsigned int band_rows = (unsigned int) max((size_t) 1, PNGWRITER_BAND_SIZE / row_size);
+    unsigned int n_bands = (image.height + band_rows - 1) / band_rows;
+    uLong adler = adler32(0L, Z_NULL, 0);
+    auto write_band = [&](PNGBand& band, unsigned int b) {
+        adler = adler32_combine(adler, band.adler, (z_off_t) band.length);
+        if (b == 0) {
+            band.data.insert(band.data.begin(), zlib_header, zlib_header + 2);
+        }
+        if (b == n_bands - 1) {
+            size_t size = band.data.size();
+            band.data.resize(size + 4);
+            put_uint32(band.data.data() + size, (uint32_t) adler);
+        }
+        write_chunk(file, "IDAT", band.data.data(), band.data.size());
+    };
+    auto encode = [&](unsigned int b) {
+        unsigned int y1 = b * band_rows;
+        unsigned int y2 = min(y1 + band_rows, image.height);
+        return encode_band(image, y1, y2, level, b == n_bands - 1);
+    };
+
+    #ifdef THREADED
+    if (options.n_threads > 1) {
+        // Keep a couple of bands per thread in flight, and write them in order as they come in
+        deque<future<PNGBand>> pending;
+        unsigned int next = 0;
+        for (unsigned int b = 0; b < n_bands; b++) {
+            while (next < n_bands && pending.size() < 2 * options.n_threads) {
+                pending.push_back(async(launch::async, encode, next));
+                next++;
+            }
+            PNGBand band = pending.front().get();
+            pending.pop_front();
+            write_band(band, b);
+        }
+    } else {
+        for (unsigned int b = 0; b < n_bands; b++) {
+            PNGBand band = encode(b);
+            write_band(band, b);
+        }
+    }
+    #else
+    for (unsigned int b = 0; b < n_bands; b++) {
+        PNGBand band = encode(b);
+        write_band(band, b);
+    }
+    #endif
+
+    write_chunk(file, "IEND", nullptr, 0);
+    if (!file) {
+        throw runtime_error("Could not write to '" + path + "'");
+    }
+}
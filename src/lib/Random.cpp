@@ -4,40 +4,79 @@
  * Created:
  *   1/22/2020, 3:20:02 PM
  * Last edited:
- *   1/29/2020, 11:44:57 AM
+ *   18/10/2026, 16:20:05
  * Auto updated?
  *   Yes
  *
  * Description:
  *   This file harbours a simpel random function, that can generate random
- *   doubles within 0.0 to 1.0. This particular file is the implementation
- *   file for Random.hpp.
+ *   doubles within 0.0 to 1.0. The renderer itself uses the Random class
+ *   instead, which is a small xoshiro256+ generator that is owned and
+ *   passed around by whoever renders a pixel, so that threads never share
+ *   any random state. This particular file is the implementation file for
+ *   Random.hpp.
 **/
 
-#include <random>
-#include <functional>
-
 #include "Random.hpp"
 
+using namespace RayTracer;
+
+
+/* Advances given splitmix64 state and returns the next value, which is used to spread a seed over the xoshiro state. */
+static uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Returns the generator used by the functions without a Random argument. Every thread gets its own. */
+static Random& thread_rng() {
+    static thread_local Random rng;
+    return rng;
+}
+
+
+
+Random::Random(uint64_t seed, uint64_t stream) {
+    this->seed(seed, stream);
+}
+
+void Random::seed(uint64_t seed, uint64_t stream) {
+    // Mix the stream into the seed first, so that neighbouring streams get unrelated states
+    uint64_t x = stream;
+    x = seed ^ splitmix64(x);
+    for (int i = 0; i < 4; i++) {
+        this->state[i] = splitmix64(x);
+    }
+}
+
+
+
 double RayTracer::random_double() {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator;
-    static std::function<double()> rand_generator = std::bind(distribution, generator);
-    return rand_generator();
+    return thread_rng().next_double();
 }
 
-RayTracer::Vec3 RayTracer::random_in_unit_sphere() {
+Vec3 RayTracer::random_in_unit_sphere() {
+    return random_in_unit_sphere(thread_rng());
+}
+
+Vec3 RayTracer::random_in_unit_sphere(Random& rng) {
     Vec3 p;
     do {
-        p = 2.0 * Vec3(random_double(), random_double(), random_double()) - 1.0;
+        p = 2.0 * Vec3(rng.next_double(), rng.next_double(), rng.next_double()) - 1.0;
     } while (p.squared_length() >= 1.0);
     return p;
 }
 
-RayTracer::Vec3 RayTracer::random_in_unit_disc() {
+Vec3 RayTracer::random_in_unit_disc() {
+    return random_in_unit_disc(thread_rng());
+}
+
+Vec3 RayTracer::random_in_unit_disc(Random& rng) {
     Vec3 p;
     do {
-        p = 2.0 * Vec3(random_double(), random_double(), 0) - Vec3(1, 1, 0);
+        p = 2.0 * Vec3(rng.next_double(), rng.next_double(), 0) - Vec3(1, 1, 0);
     } while (dot(p, p) >= 1.0);
     return p;
-}
\ No newline at end of file
+}
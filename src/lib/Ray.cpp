@@ -18,15 +18,18 @@
 using namespace std;
 using namespace RayTracer;
 
-Ray::Ray() {
-    this->origin = Vec3();
-    this->direction = Vec3();
-}
+Ray::Ray()
+    : Ray(Vec3(), Vec3())
+{}
 Ray::Ray(const Vec3& origin, const Vec3& direction) {
     this->origin = origin;
     this->direction = direction;
+    this->inv_direction = 1 / direction;
+    this->sign[0] = this->inv_direction.x < 0;
+    this->sign[1] = this->inv_direction.y < 0;
+    this->sign[2] = this->inv_direction.z < 0;
 }
 
-Vec3 Ray::point(double t) const {
+Vec3 Ray::point(scalar t) const {
     return this->origin + t * this->direction;
 }
\ No newline at end of file
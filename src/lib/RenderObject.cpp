@@ -46,7 +46,7 @@ void RenderObject::baseclass_to_json(nlohmann::json& json_obj) const {
 
 
 
-bool RenderObject::quick_hit(const Ray& ray, double t_min, double t_max) const {
+bool RenderObject::quick_hit(const Ray& ray, scalar t_min, scalar t_max) const {
     if (!this->has_hitbox) { return false; }
 
     return this->box.hit(ray, t_min, t_max);
@@ -68,7 +68,7 @@ void RenderObject::update(std::chrono::milliseconds time_passed) {
 
 
 
-RenderObject* RenderObject::from_json(json json_obj) {
+RenderObject* RenderObject::from_json(json json_obj, MaterialTable& materials) {
     // Check if the object has an object type
     if (!json_obj.is_object()) {
         throw InvalidObjectFormat("RenderObject", json::object().type_name(), json_obj.type_name());
@@ -95,9 +95,9 @@ RenderObject* RenderObject::from_json(json json_obj) {
     // Parse the rest of the object based on the type field
     RenderObject* to_return;
     if (type == sphere) {
-        to_return = (RenderObject*) Sphere::from_json(json_obj);
+        to_return = (RenderObject*) Sphere::from_json(json_obj, materials);
     } else if (type == render_object_collection) {
-        to_return = (RenderObject*) RenderObjectCollection::from_json(json_obj);
+        to_return = (RenderObject*) RenderObjectCollection::from_json(json_obj, materials);
     } else {
         throw UnknownSubtypeException("RenderObject", type);
     }
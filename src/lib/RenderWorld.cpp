@@ -18,8 +18,10 @@
 **/
 
 #include <iostream>
+#include <algorithm>
 #include <stdexcept>
 #include <cerrno>
+#include <utility>
 #include <dlfcn.h>
 
 #include "JSONExceptions.hpp"
@@ -34,16 +36,53 @@ using namespace RayTracer;
 using namespace nlohmann;
 
 
+void PixelStats::add(const Vec3& sample) {
+    this->n++;
+    for (int c = 0; c < 3; c++) {
+        double delta = sample.get(c) - this->mean[c];
+        this->mean[c] += delta / this->n;
+        this->m2[c] += delta * (sample.get(c) - this->mean[c]);
+    }
+}
+
+bool PixelStats::converged(double threshold) const {
+    if (this->n < 2) { return false; }
+
+    // Compare the error to the brightness, but don't demand the impossible of (nearly) black pixels
+    double brightness = (this->mean[0] + this->mean[1] + this->mean[2]) / 3.0;
+    double max_error = threshold * (brightness > 0.01 ? brightness : 0.01);
+    for (int c = 0; c < 3; c++) {
+        double variance = this->m2[c] / (this->n - 1);
+        if (variance / this->n > max_error * max_error) { return false; }
+    }
+    return true;
+}
+
+Vec3 PixelStats::colour(bool gamma) const {
+    if (gamma) {
+        return Vec3(sqrtf64(this->mean[0]), sqrtf64(this->mean[1]), sqrtf64(this->mean[2]));
+    }
+    return Vec3(this->mean[0], this->mean[1], this->mean[2]);
+}
+
+
+
 RenderWorld::RenderWorld() {
     this->objects = new ObjectTree();
 }
-RenderWorld::RenderWorld(const RenderWorld& other) {
+RenderWorld::RenderWorld(const RenderWorld& other)
+    : materials(other.materials),
+    integrator(other.integrator)
+{
     this->objects = new ObjectTree(*other.objects);
 }
 
-RenderWorld::RenderWorld(RenderWorld&& other) {
-    // Now fill the object's vectors with empty ones to avoid deallocation of the objects
-    other.objects = other.objects;
+RenderWorld::RenderWorld(RenderWorld&& other)
+    : materials(std::move(other.materials)),
+    integrator(other.integrator)
+{
+    // Take over the other's tree
+    this->objects = other.objects;
 
     // Empty the reference in the other list
     other.objects = nullptr;
@@ -60,6 +99,14 @@ void RenderWorld::add_object(RenderObject* obj) {
     this->objects->add(obj);
 }
 
+uint32_t RenderWorld::add_material(const Material& material) {
+    return this->materials.add(material);
+}
+
+const MaterialTable& RenderWorld::get_materials() const {
+    return this->materials;
+}
+
 
 
 std::size_t RenderWorld::get_object_count() const {
@@ -69,36 +116,116 @@ std::size_t RenderWorld::get_object_count() const {
 
 
 
-Vec3 RenderWorld::bounce_ray(const Ray& ray, int depth) const {
-    // Find the hit with the smallest hit
-    HitRecord record;
-    bool hit = this->objects->hit(ray, 0.0, numeric_limits<double>::max(), record);
+/* Returns the colour of the sky as seen by given ray. */
+static Vec3 sky_colour(const Ray& ray) {
+    Vec3 unit = ray.direction.normalize();
+    double t = 0.5 * (unit.y + 1.0);
+    return (1.0 - t) * Vec3(1, 1, 1) + t * Vec3(0.5, 0.7, 1.0);
+}
 
-    // Check if a hit occured
-    if (hit) {
-        Ray scattered;
-        Vec3 attenuation;
-        if (depth < 50 && record.material->scatter(ray, record, attenuation, scattered)) {
-            return attenuation * this->bounce_ray(scattered, depth + 1);
-        } else {
-            return Vec3(0, 0, 0);
+/* Applies the attenuation of a bounce to the throughput of a path, and decides if the path continues. If it doesn't, colour is set to black and false is returned. */
+static bool carry_light(const IntegratorOptions& integrator, const Vec3& attenuation, unsigned int depth, Vec3& throughput, Vec3& colour, Random& rng) {
+    throughput *= attenuation;
+
+    // A path that can't carry light anymore won't come back either
+    double p = max(throughput.x, max(throughput.y, throughput.z));
+    if (p <= 0) {
+        colour = Vec3(0, 0, 0);
+        return false;
+    }
+
+    // Randomly stop paths that carry little light, but weigh the survivors up so that the average stays the same
+    if (integrator.russian_roulette && depth + 1 >= integrator.min_depth) {
+        p = min(p, integrator.max_survival);
+        if (p < 1) {
+            if (rng.next_double() >= p) {
+                colour = Vec3(0, 0, 0);
+                return false;
+            }
+            throughput /= p;
         }
-    } else {
-        Vec3 unit = ray.direction.normalize();
-        double t = 0.5 * (unit.y + 1.0);
-        return (1.0 - t) * Vec3(1, 1, 1) + t * Vec3(0.5, 0.7, 1.0);
     }
+    return true;
 }
 
-Vec3 RenderWorld::render_pixel(int x, int y, const Camera& cam) const {
-    Vec3 col;
-    for (int r = 0; r < cam.rays; r++) {
-        Ray ray = cam.get_ray(x, y);
+bool RenderWorld::bounce(const Ray& ray, bool hit, const HitRecord& record, unsigned int depth, Vec3& throughput, Ray& next, Vec3& colour, Random& rng) const {
+    // If the ray didn't hit anything, it sees the sky
+    if (!hit) {
+        colour = throughput * sky_colour(ray);
+        return false;
+    }
 
-        // Get the colour
-        col += this->bounce_ray(ray);
+    // Otherwise, bounce off the material if we're allowed to
+    Vec3 attenuation;
+    if (depth >= this->integrator.max_depth || !this->materials.scatter(record.material, ray, record, attenuation, next, rng)) {
+        colour = Vec3(0, 0, 0);
+        return false;
+    }
+    return carry_light(this->integrator, attenuation, depth, throughput, colour, rng);
+}
+
+Vec3 RenderWorld::follow_ray(const Ray& ray, unsigned int depth, Vec3 throughput, Random& rng) const {
+    Ray current = ray;
+    Ray next;
+    HitRecord record;
+    Vec3 colour;
+    for (; ; depth++) {
+        bool hit = this->objects->hit(current, SCALAR_T_MIN, numeric_limits<scalar>::max(), record);
+        if (!this->bounce(current, hit, record, depth, throughput, next, colour, rng)) {
+            return colour;
+        }
+        current = next;
+    }
+}
+
+void RenderWorld::trace_packet(const Ray* rays, Random* rngs, unsigned int n, Vec3* colours) const {
+    // The rays that are still going, compacted to the front, together with the index of the path they belong to
+    Ray current[OBJECTTREE_MAX_PACKET];
+    unsigned int paths[OBJECTTREE_MAX_PACKET];
+    Vec3 throughput[OBJECTTREE_MAX_PACKET];
+    for (unsigned int i = 0; i < n; i++) {
+        current[i] = rays[i];
+        paths[i] = i;
+        throughput[i] = Vec3(1, 1, 1);
     }
 
+    HitRecord records[OBJECTTREE_MAX_PACKET];
+    bool hits[OBJECTTREE_MAX_PACKET];
+    Ray next;
+    for (unsigned int depth = 0; n > 0; depth++) {
+        this->objects->hit_packet(current, n, SCALAR_T_MIN, numeric_limits<scalar>::max(), records, hits);
+
+        // Bounce every ray once, dropping the ones whose path ended
+        unsigned int n_left = 0;
+        bool coherent = true;
+        for (unsigned int i = 0; i < n; i++) {
+            unsigned int p = paths[i];
+            if (!this->bounce(current[i], hits[i], records[i], depth, throughput[p], next, colours[p], rngs[p])) { continue; }
+            coherent &= this->materials.is_coherent(records[i].material);
+            current[n_left] = next;
+            paths[n_left] = p;
+            n_left++;
+        }
+        n = n_left;
+
+        // Once the rays have scattered in all directions, there is nothing to share anymore
+        if (!coherent) {
+            for (unsigned int i = 0; i < n; i++) {
+                unsigned int p = paths[i];
+                colours[p] = this->follow_ray(current[i], depth + 1, throughput[p], rngs[p]);
+            }
+            return;
+        }
+    }
+}
+
+Vec3 RenderWorld::bounce_ray(const Ray& ray, Random& rng) const {
+    // Instead of multiplying the attenuations on the way back, carry the fraction of light that still reaches the camera forward
+    return this->follow_ray(ray, 0, Vec3(1, 1, 1), rng);
+}
+
+/* Turns the sum of all samples of a pixel into its final colour. */
+static Vec3 resolve_pixel(const Vec3& col, const Camera& cam) {
     // Compute the colour average
     Vec3 avg_col = col / cam.rays;
     if (cam.gamma) {
@@ -109,13 +236,236 @@ Vec3 RenderWorld::render_pixel(int x, int y, const Camera& cam) const {
     }
 }
 
+Vec3 RenderWorld::render_pixel(int x, int y, const Camera& cam, uint64_t seed) const {
+    uint64_t pixel = (uint64_t) y * cam.width + x;
+
+    Vec3 col;
+    for (int r = 0; r < cam.rays; r++) {
+        // Every sample of every pixel draws from its own stream, so the result never depends on who renders it or in what order
+        Random rng(seed, (pixel << 32) | (uint64_t) r);
+        Ray ray = cam.get_ray(x, y, rng);
+
+        // Get the colour
+        col += this->bounce_ray(ray, rng);
+    }
+
+    return resolve_pixel(col, cam);
+}
+
+void RenderWorld::sample_pixel(int x, int y, const Camera& cam, uint64_t seed, PixelStats& stats, uint32_t n_samples) const {
+    uint64_t pixel = (uint64_t) y * cam.width + x;
+    for (uint32_t i = 0; i < n_samples; i++) {
+        // Use the same streams as render_pixel(), so sample r is the same no matter in which pass it's taken
+        Random rng(seed, (pixel << 32) | (uint64_t) stats.n);
+        Ray ray = cam.get_ray(x, y, rng);
+        stats.add(this->bounce_ray(ray, rng));
+    }
+}
+
+void RenderWorld::render_tile(const Tile& tile, const Camera& cam, Image& out, uint64_t seed) const {
+    if (this->integrator.wavefront_size > 0) {
+        this->render_tile_wavefront(tile, cam, out, seed);
+        return;
+    }
+
+    unsigned int packet_size = this->integrator.packet_size;
+    if (packet_size <= 1) {
+        for (int y = tile.y1; y <= tile.y2; y++) {
+            // Write the tile straight into the rows of the image
+            double* pixel = out.row(y) + 3 * tile.x1;
+            for (int x = tile.x1; x <= tile.x2; x++) {
+                Vec3 colour = this->render_pixel(x, y, cam, seed);
+                pixel[0] = colour.x;
+                pixel[1] = colour.y;
+                pixel[2] = colour.z;
+                pixel += 3;
+            }
+        }
+        return;
+    }
+
+    // Trace the rays of (close to) square blocks of pixels together, which are more coherent than a row
+    int block_width = packet_size >= 8 ? 4 : 2;
+    int block_height = packet_size / block_width;
+    Ray rays[OBJECTTREE_MAX_PACKET];
+    Random rngs[OBJECTTREE_MAX_PACKET];
+    Vec3 colours[OBJECTTREE_MAX_PACKET];
+    Vec3 sums[OBJECTTREE_MAX_PACKET];
+    for (int by = tile.y1; by <= tile.y2; by += block_height) {
+        for (int bx = tile.x1; bx <= tile.x2; bx += block_width) {
+            int x2 = min(bx + block_width - 1, tile.x2);
+            int y2 = min(by + block_height - 1, tile.y2);
+            unsigned int n = (x2 - bx + 1) * (y2 - by + 1);
+            for (unsigned int i = 0; i < n; i++) {
+                sums[i] = Vec3(0, 0, 0);
+            }
+
+            for (int r = 0; r < cam.rays; r++) {
+                // Use the same streams as render_pixel(), so that the packets give the same image
+                unsigned int i = 0;
+                for (int y = by; y <= y2; y++) {
+                    for (int x = bx; x <= x2; x++) {
+                        uint64_t pixel = (uint64_t) y * cam.width + x;
+                        rngs[i].seed(seed, (pixel << 32) | (uint64_t) r);
+                        rays[i] = cam.get_ray(x, y, rngs[i]);
+                        i++;
+                    }
+                }
+                this->trace_packet(rays, rngs, n, colours);
+                for (i = 0; i < n; i++) {
+                    sums[i] += colours[i];
+                }
+            }
+
+            unsigned int i = 0;
+            for (int y = by; y <= y2; y++) {
+                for (int x = bx; x <= x2; x++) {
+                    out.set(x, y, resolve_pixel(sums[i++], cam));
+                }
+            }
+        }
+    }
+}
+
+/* The number of buckets the wavefront sorts its rays in: one for the rays that see the sky, and one per alternative of MaterialEntry. */
+#define WAVEFRONT_BUCKETS (1 + variant_size_v<MaterialEntry>)
+
+/* The paths of one wavefront. The rays that are still going are kept compacted at the front of the queue and get reordered every bounce, while the state of the paths themselves stays where it is. */
+struct Wavefront {
+    /* The rays that are still going, and the path each of them belongs to. */
+    vector<Ray> rays;
+    vector<uint32_t> paths;
+    /* Where every ray hit something, and in which bucket it is sorted because of that. */
+    vector<HitRecord> records;
+    vector<uint8_t> buckets;
+    /* The queue positions of the rays, sorted by bucket. */
+    vector<uint32_t> order;
+    /* The rays that survive the current bounce, and the path each of them belongs to. */
+    vector<Ray> next_rays;
+    vector<uint32_t> next_paths;
+    /* The generator, the fraction of light that can still reach the camera and the final colour of every path. */
+    vector<Random> rngs;
+    vector<Vec3> throughput;
+    vector<Vec3> colours;
+    /* The number of rays in the queue, and the number of rays that survived the current bounce so far. */
+    uint32_t n;
+    uint32_t n_next;
+
+    /* Constructor for the Wavefront struct, which makes room for given number of paths. */
+    Wavefront(size_t size)
+        : rays(size), paths(size), records(size), buckets(size), order(size), next_rays(size), next_paths(size), rngs(size), throughput(size), colours(size), n(0), n_next(0)
+    {}
+
+    /* Shades the rays at positions first up to last in the order, which all hit a material of type T in given table. Since T is known, the material is called directly instead of through the vtable. */
+    template <class T>
+    void shade(const MaterialTable& materials, const IntegratorOptions& integrator, unsigned int depth, uint32_t first, uint32_t last) {
+        Ray next;
+        Vec3 attenuation;
+        for (uint32_t k = first; k < last; k++) {
+            uint32_t i = this->order[k];
+            uint32_t p = this->paths[i];
+            const HitRecord& record = this->records[i];
+            if (depth >= integrator.max_depth || !materials.get<T>(record.material).T::scatter(this->rays[i], record, attenuation, next, this->rngs[p])) {
+                this->colours[p] = Vec3(0, 0, 0);
+                continue;
+            }
+            if (carry_light(integrator, attenuation, depth, this->throughput[p], this->colours[p], this->rngs[p])) {
+                this->next_rays[this->n_next] = next;
+                this->next_paths[this->n_next] = p;
+                this->n_next++;
+            }
+        }
+    }
+
+    /* Shades the rays of every material bucket, where starts holds the first position of each bucket in the order. Calls shade() once for each alternative I of MaterialEntry, so a new material gets its own bucket automatically. */
+    template <size_t... I>
+    void shade_all(const MaterialTable& materials, const IntegratorOptions& integrator, unsigned int depth, const uint32_t* starts, index_sequence<I...>) {
+        (this->shade<variant_alternative_t<I, MaterialEntry>>(materials, integrator, depth, starts[1 + I], starts[2 + I]), ...);
+    }
+};
+
+void RenderWorld::render_tile_wavefront(const Tile& tile, const Camera& cam, Image& out, uint64_t seed) const {
+    int tile_width = tile.x2 - tile.x1 + 1;
+    uint32_t n_pixels = tile_width * (tile.y2 - tile.y1 + 1);
+    uint64_t n_paths = (uint64_t) n_pixels * cam.rays;
+    Wavefront wave(min(n_paths, (uint64_t) this->integrator.wavefront_size));
+    vector<Vec3> sums(n_pixels);
+
+    // Trace the samples of the tile in batches that fit in the wavefront, ordered by pixel and then by sample, so they are summed in the same order as render_pixel() does
+    for (uint64_t first = 0; first < n_paths; first += wave.rays.size()) {
+        uint32_t n = (uint32_t) min(n_paths - first, (uint64_t) wave.rays.size());
+        for (uint32_t p = 0; p < n; p++) {
+            uint64_t path = first + p;
+            uint32_t local = (uint32_t) (path / cam.rays);
+            int x = tile.x1 + local % tile_width;
+            int y = tile.y1 + local / tile_width;
+
+            // Use the same streams as render_pixel(), so that the wavefront gives the same image
+            uint64_t pixel = (uint64_t) y * cam.width + x;
+            wave.rngs[p].seed(seed, (pixel << 32) | (path % cam.rays));
+            wave.rays[p] = cam.get_ray(x, y, wave.rngs[p]);
+            wave.paths[p] = p;
+            wave.throughput[p] = Vec3(1, 1, 1);
+        }
+        wave.n = n;
+
+        for (unsigned int depth = 0; wave.n > 0; depth++) {
+            // Intersect all rays with the world, and note in which bucket they end up
+            uint32_t starts[WAVEFRONT_BUCKETS + 1] = { 0 };
+            for (uint32_t i = 0; i < wave.n; i++) {
+                bool hit = this->objects->hit(wave.rays[i], SCALAR_T_MIN, numeric_limits<scalar>::max(), wave.records[i]);
+                wave.buckets[i] = hit ? 1 + this->materials.type(wave.records[i].material) : 0;
+                starts[wave.buckets[i] + 1]++;
+            }
+
+            // Sort the rays by bucket with a counting sort
+            for (unsigned int b = 0; b < WAVEFRONT_BUCKETS; b++) {
+                starts[b + 1] += starts[b];
+            }
+            uint32_t next[WAVEFRONT_BUCKETS];
+            for (unsigned int b = 0; b < WAVEFRONT_BUCKETS; b++) {
+                next[b] = starts[b];
+            }
+            for (uint32_t i = 0; i < wave.n; i++) {
+                wave.order[next[wave.buckets[i]]++] = i;
+            }
+
+            // The rays that missed everything see the sky, and the rest is shaded one material at a time
+            for (uint32_t k = starts[0]; k < starts[1]; k++) {
+                uint32_t i = wave.order[k];
+                uint32_t p = wave.paths[i];
+                wave.colours[p] = wave.throughput[p] * sky_colour(wave.rays[i]);
+            }
+            wave.n_next = 0;
+            wave.shade_all(this->materials, this->integrator, depth, starts, make_index_sequence<variant_size_v<MaterialEntry>>());
+
+            // Continue with the survivors
+            swap(wave.rays, wave.next_rays);
+            swap(wave.paths, wave.next_paths);
+            wave.n = wave.n_next;
+        }
+
+        for (uint32_t p = 0; p < n; p++) {
+            sums[(first + p) / cam.rays] += wave.colours[p];
+        }
+    }
+
+    for (uint32_t local = 0; local < n_pixels; local++) {
+        out.set(tile.x1 + local % tile_width, tile.y1 + local / tile_width, resolve_pixel(sums[local], cam));
+    }
+}
+
 void RenderWorld::update(chrono::milliseconds time_passed) {
     // Loop through all objects and update them
     for (size_t i = 0; i < this->objects->size(); i++) {
         this->objects->operator[](i)->update(time_passed);
     }
-    // Re-optimise the tree
-    this->objects->optimize();
+    // Re-optimise the tree, or just fix its boxes if the objects only moved
+    if (this->objects->get_options().refit) {
+        this->objects->refit();
+    } else {
+        this->objects->optimize();
+    }
 }
 
 
@@ -124,6 +474,19 @@ void RenderWorld::optimize() {
     this->objects->optimize();
 }
 
+void RenderWorld::set_tree_options(const ObjectTreeOptions& options) {
+    this->objects->set_options(options);
+    this->objects->optimize();
+}
+
+void RenderWorld::set_integrator_options(const IntegratorOptions& options) {
+    this->integrator = options;
+}
+
+const IntegratorOptions& RenderWorld::get_integrator_options() const {
+    return this->integrator;
+}
+
 
 
 RenderWorld& RenderWorld::operator=(RenderWorld other) {
@@ -136,13 +499,11 @@ RenderWorld& RenderWorld::operator=(RenderWorld other) {
 }
 
 RenderWorld& RenderWorld::operator=(RenderWorld&& other) {
-    // Simply shallow copy the vectors
-    this->objects = other.objects;
-
-    // Now fill the object's vectors with empty ones to avoid deallocation of the objects
-    other.objects = nullptr;
-
-    // Return a reference to this
+    // Only do some stuff if this != other
+    if (this != &other) {
+        // Swap this data with the other data, so that the other deallocates our old objects
+        swap(*this, other);
+    }
     return *this;
 }
 
@@ -150,6 +511,8 @@ void RayTracer::swap(RenderWorld& first, RenderWorld& second) {
     using std::swap;
 
     swap(first.objects, second.objects);
+    swap(first.materials, second.materials);
+    swap(first.integrator, second.integrator);
 }
 
 
@@ -161,17 +524,53 @@ json RenderWorld::to_json() const {
     for (size_t i = 0; i < this->objects->size(); i++) {
         j["objects"][i] = this->objects->operator[](i)->to_json();
     }
+    j["materials"] = this->materials.to_json();
+    j["max_depth"] = this->integrator.max_depth;
+    j["min_depth"] = this->integrator.min_depth;
+    j["russian_roulette"] = this->integrator.russian_roulette;
 
     return j;
 }
-RenderWorld* RenderWorld::from_json(nlohmann::json json_obj) {
+RenderWorld* RenderWorld::from_json(nlohmann::json json_obj, const IntegratorOptions& integrator) {
     // Check if the object has an object type
     if (!json_obj.is_object()) {
         throw InvalidObjectFormat("RenderWorld", json::object().type_name(), json_obj.type_name());
     }
 
+    // Parse the integrator settings, falling back to the given ones if they aren't present
+    IntegratorOptions options = integrator;
+    if (!json_obj["max_depth"].is_null()) {
+        if (!json_obj["max_depth"].is_number_unsigned()) {
+            throw InvalidFieldFormat("RenderWorld", "max_depth", "unsigned integer", json_obj["max_depth"].type_name());
+        }
+        options.max_depth = json_obj["max_depth"].get<unsigned int>();
+    }
+    if (!json_obj["min_depth"].is_null()) {
+        if (!json_obj["min_depth"].is_number_unsigned()) {
+            throw InvalidFieldFormat("RenderWorld", "min_depth", "unsigned integer", json_obj["min_depth"].type_name());
+        }
+        options.min_depth = json_obj["min_depth"].get<unsigned int>();
+    }
+    if (!json_obj["russian_roulette"].is_null()) {
+        if (!json_obj["russian_roulette"].is_boolean()) {
+            throw InvalidFieldFormat("RenderWorld", "russian_roulette", "boolean", json_obj["russian_roulette"].type_name());
+        }
+        options.russian_roulette = json_obj["russian_roulette"].get<bool>();
+    }
+
     // Parse all the items in this array
     RenderWorld* world = new RenderWorld();
+    world->set_integrator_options(options);
+
+    // Parse the materials field if it exists, which the objects may refer to
+    if (!json_obj["materials"].is_null()) {
+        if (!json_obj["materials"].is_array()) {
+            delete world;
+            throw InvalidFieldFormat("RenderWorld", "materials", json::array().type_name(), json_obj["materials"].type_name());
+        }
+        MaterialTable materials = MaterialTable::from_json(json_obj["materials"]);
+        swap(world->materials, materials);
+    }
 
     // Parse the objects field if it exists
     if (!json_obj["objects"].is_null()) {
@@ -183,7 +582,7 @@ RenderWorld* RenderWorld::from_json(nlohmann::json json_obj) {
 
         // Parse the objects
         for (std::size_t i = 0; i < json_obj["objects"].size(); i++) {
-            world->add_object(RenderObject::from_json(json_obj["objects"][i]));
+            world->add_object(RenderObject::from_json(json_obj["objects"][i], world->materials));
         }
     }
     
@@ -16,6 +16,9 @@
  *   file for Renderer.hpp.
 **/
 
+#include <deque>
+#include <algorithm>
+
 #ifdef THREADED
 #include "ThreadPool.hpp"
 #endif
@@ -26,121 +29,257 @@ using namespace std;
 using namespace RayTracer;
 
 
-Renderer::Renderer(int num_of_threads, int batch_size, bool show_progressbar)
+Renderer::Renderer(int num_of_threads, unsigned int tile_width, unsigned int tile_height, TileOrder tile_order, bool show_progressbar, uint64_t seed)
     : n_threads(num_of_threads),
-    batch_size(batch_size),
-    show_progressbar(show_progressbar)
-{}
+    tile_width(tile_width),
+    tile_height(tile_height),
+    tile_order(tile_order),
+    show_progressbar(show_progressbar),
+    seed(seed),
+    noise_threshold(0),
+    min_rays(16),
+    max_rays(0)
+{
+    #ifdef THREADED
+    this->pool = nullptr;
+    #endif
+}
 
-Image Renderer::render(RenderWorld* world, Camera* cam) {
-    Image out(cam->width, cam->height);
-    ProgressBar prgrs(0, cam->width * cam->height - 1);
+void Renderer::set_adaptive(double noise_threshold, unsigned int min_rays, unsigned int max_rays) {
+    this->noise_threshold = noise_threshold;
+    this->min_rays = min_rays;
+    this->max_rays = max_rays;
+}
 
-    // Render it (how depends on if the program is threaded or not)
+void Renderer::run_tiles(const vector<Tile>& tiles, const function<void(const Tile&)>& job, ProgressBar* prgrs) const {
     #ifndef THREADED
 
-    for (int y = cam->height-1; y >= 0; y--) {
-        for (int x = 0; x < cam->width; x++) {
-            // Render the pixel
-            out[y][x] = world->render_pixel(x, y, *cam);
+    for (size_t i = 0; i < tiles.size(); i++) {
+        job(tiles[i]);
 
-            if (this->show_progressbar) {
-                prgrs.update();
-            }
+        if (prgrs != nullptr) {
+            prgrs->update(tiles[i].size());
         }
     }
 
     #else
 
-    // Create a thread pool
-    ThreadPool pool(this->n_threads, this->batch_size);
+    this->pool->start(tiles, job);
+    if (prgrs == nullptr) {
+        this->pool->complete();
+        return;
+    }
+
+    // Wake up every now and then to update the progressbar
+    while (!this->pool->wait_for(chrono::milliseconds(100))) {
+        prgrs->set(this->pool->progress());
+    }
+    prgrs->set(this->pool->progress());
+
+    #endif
+}
+
+void Renderer::render_frame(RenderWorld* world, Camera* cam, Image& out, uint64_t seed, const vector<Tile>& tiles, ProgressBar& prgrs) const {
+    if (this->noise_threshold > 0) {
+        this->render_adaptive(world, cam, out, seed, tiles, prgrs);
+        return;
+    }
+
+    this->run_tiles(tiles, [world, cam, &out, seed](const Tile& tile) {
+        world->render_tile(tile, *cam, out, seed);
+    }, this->show_progressbar ? &prgrs : nullptr);
+}
+
+void Renderer::render_adaptive(RenderWorld* world, Camera* cam, Image& out, uint64_t seed, const vector<Tile>& tiles, ProgressBar& prgrs) const {
+    size_t n_pixels = (size_t) cam->width * cam->height;
+    unsigned long budget = (unsigned long) cam->rays * n_pixels;
+    // We need at least two samples to say anything about the variance
+    uint32_t min_rays = max(2u, min(this->min_rays, (unsigned int) cam->rays));
+    uint32_t max_rays = max(min_rays, this->max_rays > 0 ? this->max_rays : 4 * cam->rays);
+
+    // Every pass, each pixel takes the number of samples in n_next; the first pass gives every pixel the minimum
+    vector<PixelStats> stats(n_pixels);
+    vector<uint32_t> n_next(n_pixels, min_rays);
+    auto job = [world, cam, &out, seed, &stats, &n_next](const Tile& tile) {
+        for (int y = tile.y1; y <= tile.y2; y++) {
+            for (int x = tile.x1; x <= tile.x2; x++) {
+                size_t i = (size_t) y * cam->width + x;
+                if (n_next[i] > 0) {
+                    world->sample_pixel(x, y, *cam, seed, stats[i], n_next[i]);
+                }
+            }
+        }
+    };
 
-    // Use the thread pool to render it
-    unsigned long batch_index = 0;
-    unsigned long to_do = cam->width * cam->height;
-    while (batch_index < to_do) {
-        // Update the progressbar in any case for smoothness
+    unsigned long used = 0;
+    vector<Tile> active_tiles = tiles;
+    while (!active_tiles.empty()) {
+        this->run_tiles(active_tiles, job, nullptr);
+        for (size_t i = 0; i < n_pixels; i++) {
+            used += n_next[i];
+        }
         if (this->show_progressbar) {
-            prgrs.set(batch_index);
+            prgrs.set(min(used, budget));
         }
+        if (used >= budget) { break; }
 
-        // If a the queue is full, wait for another thread to notify us it has taken an element
-        if (pool.batch_queue_full()) {
-            pool.wait();
+        // Find the pixels that are still too noisy
+        size_t n_active = 0;
+        for (size_t i = 0; i < n_pixels; i++) {
+            bool active = stats[i].n < max_rays && !stats[i].converged(this->noise_threshold);
+            n_next[i] = active ? 1 : 0;
+            n_active += active;
         }
+        if (n_active == 0) { break; }
 
-        // Create a new batch and append it
-        PixelBatch batch = pool.get_batch(cam->width, cam->height, batch_index);
-        batch.camera = cam;
-        batch.world = world;
-        batch.out = &out;
-        pool.add_batch(batch);
-    }
+        // Spread what is left of the budget over them, in steps of at most the minimum so we can re-evaluate often
+        uint32_t step = (uint32_t) min((unsigned long) min_rays, (budget - used) / n_active);
+        if (step == 0) { break; }
+        for (size_t i = 0; i < n_pixels; i++) {
+            if (n_next[i] > 0) {
+                n_next[i] = min(step, max_rays - stats[i].n);
+            }
+        }
 
-    // Wait until all threads have been reaped
-    pool.complete();
-    pool.stop();
+        // Only visit tiles that still contain noisy pixels
+        active_tiles.clear();
+        for (size_t t = 0; t < tiles.size(); t++) {
+            const Tile& tile = tiles[t];
+            bool active = false;
+            for (int y = tile.y1; y <= tile.y2 && !active; y++) {
+                for (int x = tile.x1; x <= tile.x2 && !active; x++) {
+                    active = n_next[(size_t) y * cam->width + x] > 0;
+                }
+            }
+            if (active) { active_tiles.push_back(tile); }
+        }
+    }
 
-    // Update the bar one last time
+    // Write the means to the image
+    for (int y = 0; y < cam->height; y++) {
+        for (int x = 0; x < cam->width; x++) {
+            out.set(x, y, stats[(size_t) y * cam->width + x].colour(cam->gamma));
+        }
+    }
     if (this->show_progressbar) {
-        prgrs.set(batch_index);
+        prgrs.set(budget);
     }
+}
 
+Image Renderer::render(RenderWorld* world, Camera* cam) {
+    Image out(cam->width, cam->height);
+    unsigned long n_pixels = (unsigned long) cam->width * cam->height;
+    ProgressBar prgrs(0, (this->noise_threshold > 0 ? cam->rays * n_pixels : n_pixels) - 1);
+    vector<Tile> tiles = make_tiles(cam->width, cam->height, this->tile_width, this->tile_height, this->tile_order);
+
+    // Render it (how depends on if the program is threaded or not)
+    #ifdef THREADED
+    ThreadPool pool(this->n_threads);
+    this->pool = &pool;
     #endif
 
-    return out;
-}
+    this->render_frame(world, cam, out, this->seed, tiles, prgrs);
 
-void Renderer::render_animation(RenderWorld* world, Camera* cam, Frames& out) {
     #ifdef THREADED
-    ThreadPool pool(this->n_threads, this->batch_size);
+    pool.stop();
+    this->pool = nullptr;
     #endif
 
+    return out;
+}
+
+#ifdef THREADED
+/* A frame of an animation that is being rendered, together with the state of the world and camera at that frame. */
+struct FrameInFlight {
+    /* A copy of the world as it is during this frame. */
+    RenderWorld* world;
+    /* A copy of the camera as it is during this frame. */
+    Camera* cam;
+    /* The tiles of the frame that are being rendered by the pool. */
+    shared_ptr<ThreadPoolWork> work;
+};
+
+void Renderer::render_pipelined(RenderWorld* world, Camera* cam, Frames& out, const vector<Tile>& tiles) {
+    unsigned long n_pixels = (unsigned long) cam->width * cam->height;
+    chrono::milliseconds time_passed(1000 / out.fps);
+
+    deque<FrameInFlight> in_flight;
+    std::size_t n_started = 0;
     for (std::size_t i = 0; i < out.n_frames; i++) {
-        // Render this frame
-        ProgressBar prgrs(0, cam->width * cam->height - 1, "(" + to_string(i + 1) + "/" + to_string(out.n_frames) + ")", "");
+        // Queue the tiles of the next frames behind those of this one, so that threads that run out of tiles of this frame continue with the next one
+        while (n_started < out.n_frames && n_started < i + out.frames_in_flight) {
+            if (n_started > 0) {
+                // Updating only touches the original world and camera, not the copies that earlier frames are rendered with
+                world->update(time_passed);
+                cam->update(time_passed);
+            }
 
-        #ifndef THREADED
+            FrameInFlight frame;
+            frame.world = new RenderWorld(*world);
+            frame.cam = new Camera(*cam);
+            RenderWorld* frame_world = frame.world;
+            Camera* frame_cam = frame.cam;
+            Image* frame_out = &out.get_frame(n_started);
+            // Give every frame different (but still reproducible) noise
+            uint64_t frame_seed = this->seed + n_started;
+            frame.work = this->pool->start(tiles, [frame_world, frame_cam, frame_out, frame_seed](const Tile& tile) {
+                frame_world->render_tile(tile, *frame_cam, *frame_out, frame_seed);
+            });
 
-        for (int y = cam->height-1; y >= 0; y--) {
-            for (int x = 0; x < cam->width; x++) {
-                // Render the pixel
-                out[y][x] = world->render_pixel(x, y, *cam);
+            in_flight.push_back(frame);
+            n_started++;
+        }
 
-                if (this->show_progressbar) {
-                    prgrs.update();
-                }
+        // Wait for the oldest frame, waking up every now and then to update the progressbar
+        FrameInFlight& frame = in_flight.front();
+        if (this->show_progressbar) {
+            ProgressBar prgrs(0, n_pixels - 1, "(" + to_string(i + 1) + "/" + to_string(out.n_frames) + ")", "");
+            while (!this->pool->wait_for(frame.work, chrono::milliseconds(100))) {
+                prgrs.set(this->pool->progress(frame.work));
             }
+            prgrs.set(this->pool->progress(frame.work));
+        } else {
+            this->pool->complete(frame.work);
         }
 
-        #else
+        delete frame.world;
+        delete frame.cam;
+        in_flight.pop_front();
 
-        // Use the thread pool to render it
-        unsigned long batch_index = 0;
-        unsigned long to_do = cam->width * cam->height;
-        while (batch_index < to_do) {
-            // Update the progressbar in any case for smoothness
-            if (this->show_progressbar) {
-                prgrs.set(batch_index);
-            }
+        // Hand the frame to the output
+        out.next();
+    }
+}
+#endif
 
-            // If a the queue is full, continue
-            if (pool.batch_queue_full()) {
-                pool.wait();
-            }
+void Renderer::render_animation(RenderWorld* world, Camera* cam, Frames& out) {
+    #ifdef THREADED
+    ThreadPool pool(this->n_threads);
+    this->pool = &pool;
+    #endif
 
-            // Create a new batch and append it
-            PixelBatch batch = pool.get_batch(cam->width, cam->height, batch_index);
-            batch.camera = cam;
-            batch.world = world;
-            batch.out = &out.get_current_frame();
-            pool.add_batch(batch);
-        }
+    // Note that the size of the camera never changes, so the tiles can be reused
+    vector<Tile> tiles = make_tiles(cam->width, cam->height, this->tile_width, this->tile_height, this->tile_order);
+    unsigned long n_pixels = (unsigned long) cam->width * cam->height;
 
-        // Make sure the threads are complete
-        pool.complete();
+    #ifdef THREADED
+    // Adaptive sampling needs all tiles of a pass to be done before the next, so only frames with a fixed number of rays are pipelined
+    if (out.frames_in_flight > 1 && this->noise_threshold <= 0) {
+        this->render_pipelined(world, cam, out, tiles);
+
+        pool.stop();
+        this->pool = nullptr;
+        return;
+    }
+    #endif
+
+    for (std::size_t i = 0; i < out.n_frames; i++) {
+        // Render this frame
+        ProgressBar prgrs(0, (this->noise_threshold > 0 ? cam->rays * n_pixels : n_pixels) - 1, "(" + to_string(i + 1) + "/" + to_string(out.n_frames) + ")", "");
+        // Give every frame different (but still reproducible) noise
+        uint64_t frame_seed = this->seed + i;
 
-        #endif
+        this->render_frame(world, cam, out.get_current_frame(), frame_seed, tiles, prgrs);
 
         // Update the frames
         out.next();
@@ -153,5 +292,6 @@ void Renderer::render_animation(RenderWorld* world, Camera* cam, Frames& out) {
 
     #ifdef THREADED
     pool.stop();
+    this->pool = nullptr;
     #endif
 }
\ No newline at end of file
@@ -0,0 +1,382 @@
+/* SPHERE STORE.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 15:10:42
+ * Last edited:
+ *   18/10/2026, 15:10:42
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   The SphereStore class keeps a packed copy of the centers, radii and
+ *   material indices of a list of RenderObjects, stored as separate,
+ *   aligned arrays per component. This allows the ObjectTree to hit a ray
+ *   with several spheres at once using SIMD instructions (AVX if compiled
+ *   with it, otherwise SSE2, or SSE for floats); floats with AVX test
+ *   eight spheres at once. Objects that aren't spheres get a NaN radius
+ *   so that they are never hit. This particular file is the
+ *   implementation file for SphereStore.hpp.
+**/
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#if defined __AVX__ || defined __SSE2__ || defined __SSE__
+#include <immintrin.h>
+#endif
+
+#include "Sphere.hpp"
+#include "SphereStore.hpp"
+
+using namespace std;
+using namespace RayTracer;
+
+
+SphereStore::SphereStore()
+    : data(nullptr),
+    n(0),
+    capacity(0),
+    others(false),
+    x(nullptr),
+    y(nullptr),
+    z(nullptr),
+    radius(nullptr),
+    material(nullptr)
+{}
+
+SphereStore::SphereStore(const SphereStore& other)
+    : SphereStore()
+{
+    this->resize(other.n);
+    this->others = other.others;
+    if (this->capacity > 0) {
+        memcpy(this->data, other.data, this->bytes());
+    }
+}
+
+SphereStore::SphereStore(SphereStore&& other)
+    : data(other.data),
+    n(other.n),
+    capacity(other.capacity),
+    others(other.others),
+    x(other.x),
+    y(other.y),
+    z(other.z),
+    radius(other.radius),
+    material(other.material)
+{
+    other.data = nullptr;
+    other.n = 0;
+    other.capacity = 0;
+}
+
+SphereStore::~SphereStore() {
+    free(this->data);
+}
+
+
+
+void SphereStore::resize(size_t n) {
+    this->n = n;
+
+    // A range may start anywhere, so its last block can stick out up to SPHERESTORE_WIDTH - 1 lanes past the final
+    //   object. Reserve that many padding lanes, rounded up to SPHERESTORE_LANES so that every array starts aligned.
+    size_t capacity = n > 0 ? (n + SPHERESTORE_WIDTH - 1 + SPHERESTORE_LANES - 1) / SPHERESTORE_LANES * SPHERESTORE_LANES : 0;
+    if (capacity == this->capacity) { return; }
+
+    free(this->data);
+    this->data = nullptr;
+    this->capacity = capacity;
+    if (capacity > 0) {
+        // Note that aligned_alloc wants the size to be a multiple of the alignment, which bytes() rounds up to
+        this->data = (scalar*) aligned_alloc(SPHERESTORE_ALIGNMENT, this->bytes());
+        if (this->data == nullptr) { throw bad_alloc(); }
+    }
+    this->x = this->data;
+    this->y = this->data + capacity;
+    this->z = this->data + 2 * capacity;
+    this->radius = this->data + 3 * capacity;
+    // Every scalar array is SPHERESTORE_LANES * k scalars, i.e., a multiple of SPHERESTORE_ALIGNMENT bytes, so the
+    //   material array after them is aligned as well
+    this->material = (uint32_t*) (this->data + 4 * capacity);
+}
+
+void SphereStore::update(const vector<RenderObject*>& objects) {
+    this->resize(objects.size());
+
+    this->others = false;
+    for (size_t i = 0; i < this->capacity; i++) {
+        if (i < this->n && objects[i]->type == sphere) {
+            Sphere* s = (Sphere*) objects[i];
+            this->x[i] = s->center.x;
+            this->y[i] = s->center.y;
+            this->z[i] = s->center.z;
+            this->radius[i] = s->radius;
+            this->material[i] = s->material;
+        } else {
+            // Either padding or no sphere; make sure it can never be hit
+            this->x[i] = 0;
+            this->y[i] = 0;
+            this->z[i] = 0;
+            this->radius[i] = numeric_limits<scalar>::quiet_NaN();
+            this->material[i] = 0;
+            if (i < this->n) { this->others = true; }
+        }
+    }
+}
+
+
+
+bool SphereStore::hit(const Ray& ray, size_t start, size_t n, scalar t_min, scalar t_max, size_t& index, scalar& t) const {
+    // Everything below mirrors Sphere::hit(), but then for multiple spheres at once
+    scalar a = dot(ray.direction, ray.direction);
+    scalar t_best = t_max;
+    bool hit = false;
+
+    size_t i = start;
+    size_t end = start + n;
+
+    #if defined FLOAT32 && defined __AVX__
+    __m256 v_ox = _mm256_set1_ps(ray.origin.x);
+    __m256 v_oy = _mm256_set1_ps(ray.origin.y);
+    __m256 v_oz = _mm256_set1_ps(ray.origin.z);
+    __m256 v_dx = _mm256_set1_ps(ray.direction.x);
+    __m256 v_dy = _mm256_set1_ps(ray.direction.y);
+    __m256 v_dz = _mm256_set1_ps(ray.direction.z);
+    __m256 v_a = _mm256_set1_ps(a);
+    __m256 v_zero = _mm256_setzero_ps();
+    __m256 v_inf = _mm256_set1_ps(numeric_limits<float>::infinity());
+    __m256 v_t_min = _mm256_set1_ps(t_min);
+    for (; i < end; i += 8) {
+        // The last block may read up to SPHERESTORE_WIDTH - 1 lanes past the range; those are either other objects or
+        //   NaN-radius padding (see resize()), and are skipped when reducing below
+        __m256 ocx = _mm256_sub_ps(v_ox, _mm256_loadu_ps(this->x + i));
+        __m256 ocy = _mm256_sub_ps(v_oy, _mm256_loadu_ps(this->y + i));
+        __m256 ocz = _mm256_sub_ps(v_oz, _mm256_loadu_ps(this->z + i));
+        __m256 r = _mm256_loadu_ps(this->radius + i);
+
+        __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, v_dx), _mm256_mul_ps(ocy, v_dy)), _mm256_mul_ps(ocz, v_dz));
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz)), _mm256_mul_ps(r, r));
+        __m256 D = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(v_a, c));
+        __m256 positive = _mm256_cmp_ps(D, v_zero, _CMP_GT_OQ);
+
+        // Compute both roots, and keep the nearest one that lies within range
+        __m256 v_t_max = _mm256_set1_ps(t_best);
+        __m256 sq = _mm256_sqrt_ps(D);
+        __m256 nb = _mm256_sub_ps(v_zero, b);
+        __m256 t0 = _mm256_div_ps(_mm256_sub_ps(nb, sq), v_a);
+        __m256 t1 = _mm256_div_ps(_mm256_add_ps(nb, sq), v_a);
+        __m256 valid0 = _mm256_and_ps(positive, _mm256_and_ps(_mm256_cmp_ps(t0, v_t_min, _CMP_GT_OQ), _mm256_cmp_ps(t0, v_t_max, _CMP_LT_OQ)));
+        __m256 valid1 = _mm256_and_ps(positive, _mm256_and_ps(_mm256_cmp_ps(t1, v_t_min, _CMP_GT_OQ), _mm256_cmp_ps(t1, v_t_max, _CMP_LT_OQ)));
+        if (_mm256_movemask_ps(_mm256_or_ps(valid0, valid1)) == 0) { continue; }
+        __m256 v_t = _mm256_blendv_ps(_mm256_blendv_ps(v_inf, t1, valid1), t0, valid0);
+
+        // Reduce the lanes that are part of the range
+        alignas(SPHERESTORE_ALIGNMENT) float ts[8];
+        _mm256_store_ps(ts, v_t);
+        for (size_t k = 0; k < 8 && i + k < end; k++) {
+            if (ts[k] < t_best) {
+                t_best = ts[k];
+                index = i + k;
+                hit = true;
+            }
+        }
+    }
+    #elif defined FLOAT32 && defined __SSE__
+    __m128 v_ox = _mm_set1_ps(ray.origin.x);
+    __m128 v_oy = _mm_set1_ps(ray.origin.y);
+    __m128 v_oz = _mm_set1_ps(ray.origin.z);
+    __m128 v_dx = _mm_set1_ps(ray.direction.x);
+    __m128 v_dy = _mm_set1_ps(ray.direction.y);
+    __m128 v_dz = _mm_set1_ps(ray.direction.z);
+    __m128 v_a = _mm_set1_ps(a);
+    __m128 v_zero = _mm_setzero_ps();
+    __m128 v_inf = _mm_set1_ps(numeric_limits<float>::infinity());
+    __m128 v_t_min = _mm_set1_ps(t_min);
+    for (; i < end; i += 4) {
+        // The last block may read up to SPHERESTORE_WIDTH - 1 lanes past the range; those are either other objects or
+        //   NaN-radius padding (see resize()), and are skipped when reducing below
+        __m128 ocx = _mm_sub_ps(v_ox, _mm_loadu_ps(this->x + i));
+        __m128 ocy = _mm_sub_ps(v_oy, _mm_loadu_ps(this->y + i));
+        __m128 ocz = _mm_sub_ps(v_oz, _mm_loadu_ps(this->z + i));
+        __m128 r = _mm_loadu_ps(this->radius + i);
+
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, v_dx), _mm_mul_ps(ocy, v_dy)), _mm_mul_ps(ocz, v_dz));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)), _mm_mul_ps(r, r));
+        __m128 D = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(v_a, c));
+        __m128 positive = _mm_cmpgt_ps(D, v_zero);
+
+        // Compute both roots, and keep the nearest one that lies within range
+        __m128 v_t_max = _mm_set1_ps(t_best);
+        __m128 sq = _mm_sqrt_ps(D);
+        __m128 nb = _mm_sub_ps(v_zero, b);
+        __m128 t0 = _mm_div_ps(_mm_sub_ps(nb, sq), v_a);
+        __m128 t1 = _mm_div_ps(_mm_add_ps(nb, sq), v_a);
+        __m128 valid0 = _mm_and_ps(positive, _mm_and_ps(_mm_cmpgt_ps(t0, v_t_min), _mm_cmplt_ps(t0, v_t_max)));
+        __m128 valid1 = _mm_and_ps(positive, _mm_and_ps(_mm_cmpgt_ps(t1, v_t_min), _mm_cmplt_ps(t1, v_t_max)));
+        if (_mm_movemask_ps(_mm_or_ps(valid0, valid1)) == 0) { continue; }
+        __m128 v_t = _mm_or_ps(_mm_and_ps(valid0, t0), _mm_andnot_ps(valid0, _mm_or_ps(_mm_and_ps(valid1, t1), _mm_andnot_ps(valid1, v_inf))));
+
+        // Reduce the lanes that are part of the range
+        alignas(16) float ts[4];
+        _mm_store_ps(ts, v_t);
+        for (size_t k = 0; k < 4 && i + k < end; k++) {
+            if (ts[k] < t_best) {
+                t_best = ts[k];
+                index = i + k;
+                hit = true;
+            }
+        }
+    }
+    #elif defined __AVX__
+    __m256d v_ox = _mm256_set1_pd(ray.origin.x);
+    __m256d v_oy = _mm256_set1_pd(ray.origin.y);
+    __m256d v_oz = _mm256_set1_pd(ray.origin.z);
+    __m256d v_dx = _mm256_set1_pd(ray.direction.x);
+    __m256d v_dy = _mm256_set1_pd(ray.direction.y);
+    __m256d v_dz = _mm256_set1_pd(ray.direction.z);
+    __m256d v_a = _mm256_set1_pd(a);
+    __m256d v_zero = _mm256_setzero_pd();
+    __m256d v_inf = _mm256_set1_pd(numeric_limits<double>::infinity());
+    __m256d v_t_min = _mm256_set1_pd(t_min);
+    for (; i < end; i += 4) {
+        // The last block may read up to SPHERESTORE_WIDTH - 1 lanes past the range; those are either other objects or
+        //   NaN-radius padding (see resize()), and are skipped when reducing below
+        __m256d ocx = _mm256_sub_pd(v_ox, _mm256_loadu_pd(this->x + i));
+        __m256d ocy = _mm256_sub_pd(v_oy, _mm256_loadu_pd(this->y + i));
+        __m256d ocz = _mm256_sub_pd(v_oz, _mm256_loadu_pd(this->z + i));
+        __m256d r = _mm256_loadu_pd(this->radius + i);
+
+        __m256d b = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, v_dx), _mm256_mul_pd(ocy, v_dy)), _mm256_mul_pd(ocz, v_dz));
+        __m256d c = _mm256_sub_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, ocx), _mm256_mul_pd(ocy, ocy)), _mm256_mul_pd(ocz, ocz)), _mm256_mul_pd(r, r));
+        __m256d D = _mm256_sub_pd(_mm256_mul_pd(b, b), _mm256_mul_pd(v_a, c));
+        __m256d positive = _mm256_cmp_pd(D, v_zero, _CMP_GT_OQ);
+
+        // Compute both roots, and keep the nearest one that lies within range
+        __m256d v_t_max = _mm256_set1_pd(t_best);
+        __m256d sq = _mm256_sqrt_pd(D);
+        __m256d nb = _mm256_sub_pd(v_zero, b);
+        __m256d t0 = _mm256_div_pd(_mm256_sub_pd(nb, sq), v_a);
+        __m256d t1 = _mm256_div_pd(_mm256_add_pd(nb, sq), v_a);
+        __m256d valid0 = _mm256_and_pd(positive, _mm256_and_pd(_mm256_cmp_pd(t0, v_t_min, _CMP_GT_OQ), _mm256_cmp_pd(t0, v_t_max, _CMP_LT_OQ)));
+        __m256d valid1 = _mm256_and_pd(positive, _mm256_and_pd(_mm256_cmp_pd(t1, v_t_min, _CMP_GT_OQ), _mm256_cmp_pd(t1, v_t_max, _CMP_LT_OQ)));
+        if (_mm256_movemask_pd(_mm256_or_pd(valid0, valid1)) == 0) { continue; }
+        __m256d v_t = _mm256_blendv_pd(_mm256_blendv_pd(v_inf, t1, valid1), t0, valid0);
+
+        // Reduce the lanes that are part of the range
+        alignas(SPHERESTORE_ALIGNMENT) double ts[4];
+        _mm256_store_pd(ts, v_t);
+        for (size_t k = 0; k < 4 && i + k < end; k++) {
+            if (ts[k] < t_best) {
+                t_best = ts[k];
+                index = i + k;
+                hit = true;
+            }
+        }
+    }
+    #elif defined __SSE2__
+    __m128d v_ox = _mm_set1_pd(ray.origin.x);
+    __m128d v_oy = _mm_set1_pd(ray.origin.y);
+    __m128d v_oz = _mm_set1_pd(ray.origin.z);
+    __m128d v_dx = _mm_set1_pd(ray.direction.x);
+    __m128d v_dy = _mm_set1_pd(ray.direction.y);
+    __m128d v_dz = _mm_set1_pd(ray.direction.z);
+    __m128d v_a = _mm_set1_pd(a);
+    __m128d v_zero = _mm_setzero_pd();
+    __m128d v_inf = _mm_set1_pd(numeric_limits<double>::infinity());
+    __m128d v_t_min = _mm_set1_pd(t_min);
+    for (; i < end; i += 2) {
+        // The last block may read up to SPHERESTORE_WIDTH - 1 lanes past the range; those are either other objects or
+        //   NaN-radius padding (see resize()), and are skipped when reducing below
+        __m128d ocx = _mm_sub_pd(v_ox, _mm_loadu_pd(this->x + i));
+        __m128d ocy = _mm_sub_pd(v_oy, _mm_loadu_pd(this->y + i));
+        __m128d ocz = _mm_sub_pd(v_oz, _mm_loadu_pd(this->z + i));
+        __m128d r = _mm_loadu_pd(this->radius + i);
+
+        __m128d b = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, v_dx), _mm_mul_pd(ocy, v_dy)), _mm_mul_pd(ocz, v_dz));
+        __m128d c = _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, ocx), _mm_mul_pd(ocy, ocy)), _mm_mul_pd(ocz, ocz)), _mm_mul_pd(r, r));
+        __m128d D = _mm_sub_pd(_mm_mul_pd(b, b), _mm_mul_pd(v_a, c));
+        __m128d positive = _mm_cmpgt_pd(D, v_zero);
+
+        // Compute both roots, and keep the nearest one that lies within range
+        __m128d v_t_max = _mm_set1_pd(t_best);
+        __m128d sq = _mm_sqrt_pd(D);
+        __m128d nb = _mm_sub_pd(v_zero, b);
+        __m128d t0 = _mm_div_pd(_mm_sub_pd(nb, sq), v_a);
+        __m128d t1 = _mm_div_pd(_mm_add_pd(nb, sq), v_a);
+        __m128d valid0 = _mm_and_pd(positive, _mm_and_pd(_mm_cmpgt_pd(t0, v_t_min), _mm_cmplt_pd(t0, v_t_max)));
+        __m128d valid1 = _mm_and_pd(positive, _mm_and_pd(_mm_cmpgt_pd(t1, v_t_min), _mm_cmplt_pd(t1, v_t_max)));
+        if (_mm_movemask_pd(_mm_or_pd(valid0, valid1)) == 0) { continue; }
+        __m128d v_t = _mm_or_pd(_mm_and_pd(valid0, t0), _mm_andnot_pd(valid0, _mm_or_pd(_mm_and_pd(valid1, t1), _mm_andnot_pd(valid1, v_inf))));
+
+        // Reduce the lanes that are part of the range
+        alignas(16) double ts[2];
+        _mm_store_pd(ts, v_t);
+        for (size_t k = 0; k < 2 && i + k < end; k++) {
+            if (ts[k] < t_best) {
+                t_best = ts[k];
+                index = i + k;
+                hit = true;
+            }
+        }
+    }
+    #else
+    for (; i < end; i++) {
+        if (!this->is_sphere(i)) { continue; }
+        scalar ocx = ray.origin.x - this->x[i];
+        scalar ocy = ray.origin.y - this->y[i];
+        scalar ocz = ray.origin.z - this->z[i];
+        scalar b = ocx * ray.direction.x + ocy * ray.direction.y + ocz * ray.direction.z;
+        scalar c = ocx * ocx + ocy * ocy + ocz * ocz - this->radius[i] * this->radius[i];
+        scalar D = b * b - a * c;
+        if (D > 0) {
+            scalar t_i = (-b - sqrt(D)) / a;
+            if (t_i <= t_min || t_i >= t_best) {
+                t_i = (-b + sqrt(D)) / a;
+                if (t_i <= t_min || t_i >= t_best) { continue; }
+            }
+            t_best = t_i;
+            index = i;
+            hit = true;
+        }
+    }
+    #endif
+
+    if (hit) { t = t_best; }
+    return hit;
+}
+
+
+
+SphereStore& SphereStore::operator=(SphereStore other) {
+    if (this != &other) {
+        // Copy by swapping
+        swap(*this, other);
+    }
+    return *this;
+}
+
+SphereStore& SphereStore::operator=(SphereStore&& other) {
+    if (this != &other) {
+        // Move by swapping
+        swap(*this, other);
+    }
+    return *this;
+}
+
+void RayTracer::swap(SphereStore& first, SphereStore& second) {
+    using std::swap;
+
+    swap(first.data, second.data);
+    swap(first.n, second.n);
+    swap(first.capacity, second.capacity);
+    swap(first.others, second.others);
+    swap(first.x, second.x);
+    swap(first.y, second.y);
+    swap(first.z, second.z);
+    swap(first.radius, second.radius);
+    swap(first.material, second.material);
+}
@@ -4,7 +4,7 @@
  * Created:
  *   1/25/2020, 5:10:34 PM
  * Last edited:
- *   2/9/2020, 5:41:28 PM
+ *   18/10/2026, 17:02:40
  * Auto updated?
  *   Yes
  *
@@ -12,10 +12,17 @@
  *   The ThreadPool class is a collection of threads that are functioning
  *   as a thread pool. The idea is that they execute the same function
  *   multiple times with different data, until the stop signal is given.
+ *   The tiles of an image are divided over the workers, each of which
+ *   has its own queue. Workers that run out of work steal from the back
+ *   of the queues of the others, so no global lock is taken per tile.
+ *   New work can be started before earlier work is done, in which case
+ *   its tiles are queued behind those of the earlier work, so that the
+ *   workers never run dry between frames.
  *   This particular file is the implementation file for ThreadPool.hpp.
 **/
 
 #include <iostream>
+#include <algorithm>
 
 #include "ThreadPool.hpp"
 
@@ -23,14 +30,12 @@ using namespace std;
 using namespace RayTracer;
 
 
-ThreadPool::ThreadPool(unsigned int num_of_threads, unsigned int batch_size, unsigned int max_in_queue)
-    : max_in_queue(max_in_queue),
-    n_threads(num_of_threads),
-    batch_size(batch_size)
+ThreadPool::ThreadPool(unsigned int num_of_threads)
+    : n_threads(num_of_threads > 0 ? num_of_threads : 1),
+    working(true),
+    generation(0),
+    queues(num_of_threads > 0 ? num_of_threads : 1)
 {
-    this->working = true;
-    this->threads_waiting = 0;
-
     // Create the correct amount of threads
     this->pool.resize(this->n_threads);
     for (unsigned int i = 0; i < this->n_threads; i++) {
@@ -42,110 +47,128 @@ ThreadPool::~ThreadPool() {
 }
 
 void ThreadPool::worker(unsigned int id) {
-    // Run while directed to do so
-    while (this->working) {
-        // Create a scope to indicate the mutex duration
-        PixelBatch batch;
-        {   
-            // Acquire the lock
-            unique_lock<mutex> u_lock(this->batch_lock);
-
-            // Get some references to class variables
-            vector<PixelBatch>* queue = &this->batch_queue;
-            bool* working = &this->working;
-
-            // Wait until work is available OR we're stopping
-            this->threads_waiting++;
-            this->batch_cond.wait(u_lock, [working, queue](){ return !queue->empty() || !(*working); });
-            this->threads_waiting--;
-
-            // Signal the main thread that it can start filling the queue again
-            this->wake_cond.notify_all();
-
-            // Acquire the first batch if and only if we didn't stop because of work
-            if (this->working) {
-                batch = this->batch_queue.at(this->batch_queue.size() - 1);
-                this->batch_queue.pop_back();
-            }
+    unsigned long seen = 0;
+    while (true) {
+        // Sleep until new work is started or we're stopping
+        {
+            unique_lock<mutex> u_lock(this->state_lock);
+            this->work_cond.wait(u_lock, [this, seen](){ return !this->working || this->generation != seen; });
+            if (!this->working) { return; }
+            seen = this->generation;
         }
 
-        // Only do the work if we woke up because of work
-        if (this->working) {
-            this->render_batch(batch);
+        // Render tiles until there are none left anywhere
+        WorkerTile item;
+        while (this->take_tile(id, item)) {
+            item.work->job(item.tile);
+
+            item.work->n_done += item.tile.size();
+            if (item.work->n_remaining.fetch_sub(1) == 1) {
+                // This was the last tile of its work; take the lock so the waiting thread cannot miss the signal
+                lock_guard<mutex> l_lock(this->state_lock);
+                this->done_cond.notify_all();
+            }
+            item.work.reset();
         }
     }
 }
 
-void ThreadPool::render_batch(const PixelBatch& batch) const {
-    for (int y = batch.y2; y >= batch.y1; y--) {
-        for (int x = batch.x1; x <= batch.x2; x++) {
-            batch.out->operator[](y)[x] = batch.world->render_pixel(x, y, *batch.camera);
+bool ThreadPool::take_tile(unsigned int id, WorkerTile& tile) {
+    // First try our own queue
+    {
+        WorkerQueue& own = this->queues[id];
+        lock_guard<mutex> l_lock(own.lock);
+        if (!own.tiles.empty()) {
+            tile = own.tiles.front();
+            own.tiles.pop_front();
+            return true;
         }
     }
-}
 
-PixelBatch ThreadPool::get_batch(unsigned int width, unsigned int height, unsigned long& batch_index) const {
-    PixelBatch batch;
-
-    batch.x1 = batch_index % width;
-    batch.y1 = batch_index / width;
-
-    batch_index += this->batch_size - 1;
-    // Bind batch_index to a maximum of (w - 1) * (h - 1)
-    if (batch_index > width * height) {
-        batch_index = width *  height - 1;
+    // Otherwise, steal from someone else's queue: the last tile of the oldest work in it, which is far from where its owner is working but still lets earlier work finish first
+    for (unsigned int i = 1; i < this->n_threads; i++) {
+        WorkerQueue& victim = this->queues[(id + i) % this->n_threads];
+        lock_guard<mutex> l_lock(victim.lock);
+        if (!victim.tiles.empty()) {
+            ThreadPoolWork* oldest = victim.tiles.front().work.get();
+            deque<WorkerTile>::iterator end = partition_point(victim.tiles.begin(), victim.tiles.end(), [oldest](const WorkerTile& t) { return t.work.get() == oldest; });
+            tile = std::move(*(end - 1));
+            victim.tiles.erase(end - 1);
+            return true;
+        }
     }
+    return false;
+}
 
-    batch.x2 = batch_index % width;
-    batch.y2 = batch_index / width;
 
-    batch_index++;
 
-    return batch;
-}
 
-bool ThreadPool::batch_queue_full() const {
-    return this->batch_queue.size() == this->max_in_queue;
-}
+shared_ptr<ThreadPoolWork> ThreadPool::start(const vector<Tile>& tiles, const function<void(const Tile&)>& job) {
+    shared_ptr<ThreadPoolWork> work = make_shared<ThreadPoolWork>();
+    work->job = job;
+    work->n_remaining = tiles.size();
+    work->n_done = 0;
+    {
+        lock_guard<mutex> l_lock(this->state_lock);
+        this->current = work;
+    }
+    if (tiles.empty()) { return work; }
 
-void ThreadPool::add_batch(const PixelBatch& batch) {
-    // Acquire the lock
-    std::unique_lock<mutex> u_lock(this->batch_lock);
-    if (this->batch_queue.size() >= this->max_in_queue) {
-        return;
+    // Give every worker a contiguous part of the tile list, so that with a space-filling order neighbouring tiles (and thus similar rays) stay on one core
+    for (unsigned int i = 0; i < this->n_threads; i++) {
+        size_t begin = tiles.size() * i / this->n_threads;
+        size_t end = tiles.size() * (i + 1) / this->n_threads;
+
+        // Any tiles of earlier work that are still in the queue go first
+        WorkerQueue& queue = this->queues[i];
+        lock_guard<mutex> l_lock(queue.lock);
+        for (size_t t = begin; t < end; t++) {
+            queue.tiles.push_back({ tiles[t], work });
+        }
     }
 
-    this->batch_queue.push_back(batch);
+    // Wake everyone up
+    {
+        lock_guard<mutex> l_lock(this->state_lock);
+        this->generation++;
+    }
+    this->work_cond.notify_all();
+    return work;
+}
 
-    // Wake a thread up
-    this->batch_cond.notify_one();
+shared_ptr<ThreadPoolWork> ThreadPool::start(const vector<Tile>& tiles, const Camera& cam, const RenderWorld& world, Image& out, uint64_t seed) {
+    return this->start(tiles, [&cam, &world, &out, seed](const Tile& tile) {
+        world.render_tile(tile, cam, out, seed);
+    });
 }
-void ThreadPool::add_batch(unsigned int width, unsigned int height, const Camera& cam, const RenderWorld& world, Image& out, unsigned long& batch_index) {
-    PixelBatch batch = this->get_batch(width, height, batch_index);
-    batch.camera = &cam;
-    batch.world = &world;
-    batch.out = &out;
 
-    this->add_batch(batch);
+bool ThreadPool::wait_for(const shared_ptr<ThreadPoolWork>& work, chrono::milliseconds timeout) {
+    unique_lock<mutex> u_lock(this->state_lock);
+    return this->done_cond.wait_for(u_lock, timeout, [&work](){ return work->n_remaining == 0; });
 }
 
+bool ThreadPool::wait_for(chrono::milliseconds timeout) {
+    return this->wait_for(this->current, timeout);
+}
 
-void ThreadPool::wait() {
-    unique_lock<mutex> u_lock(this->wake_lock);
+unsigned long ThreadPool::progress(const shared_ptr<ThreadPoolWork>& work) const {
+    return work->n_done;
+}
 
-    // Wait for the conditional variable to be triggered
-    this->wake_cond.wait(u_lock, [this](){ return !this->batch_queue_full(); });
+unsigned long ThreadPool::progress() const {
+    return this->progress(this->current);
 }
 
 
+
 void ThreadPool::stop() {
     // Try to stop the threads
     {
-        unique_lock<mutex> u_lock(this->batch_lock);
+        unique_lock<mutex> u_lock(this->state_lock);
         this->working = false;
     }
 
-    this->batch_cond.notify_all();
+    this->work_cond.notify_all();
     
     for (unsigned int i = 0; i < this->n_threads; i++) {
         if (this->pool[i].joinable()) {
@@ -153,14 +176,12 @@ void ThreadPool::stop() {
         }
     }
 }
+void ThreadPool::complete(const shared_ptr<ThreadPoolWork>& work) {
+    // Sleep until the last tile of the work is rendered
+    unique_lock<mutex> u_lock(this->state_lock);
+    this->done_cond.wait(u_lock, [&work](){ return work->n_remaining == 0; });
+}
+
 void ThreadPool::complete() {
-    // Wait until all threads are waiting
-    while (true) {
-        {
-            unique_lock<mutex> u_lock(this->batch_lock);
-            if (this->batch_queue.empty() && this->threads_waiting == this->n_threads) {
-                return;
-            }
-        }
-    }
-}
\ No newline at end of file
+    this->complete(this->current);
+}
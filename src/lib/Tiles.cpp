@@ -0,0 +1,100 @@
+/* TILES.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 17:31:08
+ * Last edited:
+ *   18/10/2026, 17:31:08
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   Splits an image into rectangular tiles, which are the units of work
+ *   for the renderer. Rendering a compact tile instead of a long strip of
+ *   a scanline keeps the rays that are in flight on one core close
+ *   together, so that they hit the same parts of the object tree. The
+ *   tiles can be put in scanline, Morton (Z-curve) or Hilbert order. This
+ *   particular file is the implementation file for Tiles.hpp.
+**/
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Tiles.hpp"
+
+using namespace std;
+using namespace RayTracer;
+
+
+/* Returns the position of the tile at (x, y) along the Morton curve, by interleaving the bits of x and y. */
+static uint64_t morton_index(uint32_t x, uint32_t y) {
+    uint64_t index = 0;
+    for (int b = 0; b < 32; b++) {
+        index |= (uint64_t) ((x >> b) & 1) << (2 * b);
+        index |= (uint64_t) ((y >> b) & 1) << (2 * b + 1);
+    }
+    return index;
+}
+
+/* Returns the position of the tile at (x, y) along the Hilbert curve that covers an n x n grid, where n is a power of two. */
+static uint64_t hilbert_index(uint32_t n, uint32_t x, uint32_t y) {
+    uint64_t index = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        index += (uint64_t) s * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so that the curve inside it connects to its neighbours
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return index;
+}
+
+
+
+vector<Tile> RayTracer::make_tiles(unsigned int width, unsigned int height, unsigned int tile_width, unsigned int tile_height, TileOrder order) {
+    if (tile_width < 1) { tile_width = 1; }
+    if (tile_height < 1) { tile_height = 1; }
+    unsigned int nx = (width + tile_width - 1) / tile_width;
+    unsigned int ny = (height + tile_height - 1) / tile_height;
+
+    // Compute the position of every tile along the chosen curve
+    uint32_t n = 1;
+    while (n < nx || n < ny) { n *= 2; }
+    vector<pair<uint64_t, Tile>> tiles;
+    tiles.reserve((size_t) nx * ny);
+    for (unsigned int ty = 0; ty < ny; ty++) {
+        for (unsigned int tx = 0; tx < nx; tx++) {
+            Tile tile;
+            tile.x1 = tx * tile_width;
+            tile.y1 = ty * tile_height;
+            tile.x2 = min(tile.x1 + tile_width, width) - 1;
+            tile.y2 = min(tile.y1 + tile_height, height) - 1;
+
+            uint64_t index;
+            if (order == morton_order) {
+                index = morton_index(tx, ty);
+            } else if (order == hilbert_order) {
+                index = hilbert_index(n, tx, ty);
+            } else {
+                index = (uint64_t) ty * nx + tx;
+            }
+            tiles.push_back(make_pair(index, tile));
+        }
+    }
+
+    // Sort them along it; the grid may not be square or a power of two, so the curve may skip some positions
+    sort(tiles.begin(), tiles.end(), [](const pair<uint64_t, Tile>& a, const pair<uint64_t, Tile>& b) { return a.first < b.first; });
+    vector<Tile> result;
+    result.reserve(tiles.size());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        result.push_back(tiles[i].second);
+    }
+    return result;
+}
@@ -13,7 +13,8 @@
  *   in the optimised tree search for objects. It does not much more than
  *   to store the two points that make up the box and one function to merge
  *   it with a larger one, and one function to check if it has been hit by
- *   a ray. This file is the header file for BoundingBox.cpp.
+ *   a ray. The latter is inlined here, as it is the hottest function in
+ *   the object tree. This file is the header file for BoundingBox.cpp.
 **/
 
 #ifndef BOUNDINGBOX_HPP
@@ -34,13 +35,40 @@ namespace RayTracer {
             BoundingBox(Vec3 p1, Vec3 p2): p1(p1), p2(p2) {}
 
             /* Checks whether this boundingbox is hit by given ray or not. */
-            bool hit(const Ray& ray, double t_min, double t_max) const;
+            inline bool hit(const Ray& ray, scalar t_min, scalar t_max) const {
+                scalar t_enter;
+                return this->hit(ray, t_min, t_max, t_enter);
+            }
+            /* Checks whether this boundingbox is hit by given ray or not, and stores the distance at which the ray enters the box in t_enter. Assumes that p1 is the lower corner and p2 the upper corner. */
+            inline bool hit(const Ray& ray, scalar t_min, scalar t_max, scalar& t_enter) const {
+                // The signs of the ray tell through which side it enters each slab, so there is no need to order the t's
+                const Vec3* bounds[2] = { &this->p1, &this->p2 };
+                scalar tx0 = (bounds[ray.sign[0]]->x - ray.origin.x) * ray.inv_direction.x;
+                scalar tx1 = (bounds[1 - ray.sign[0]]->x - ray.origin.x) * ray.inv_direction.x;
+                scalar ty0 = (bounds[ray.sign[1]]->y - ray.origin.y) * ray.inv_direction.y;
+                scalar ty1 = (bounds[1 - ray.sign[1]]->y - ray.origin.y) * ray.inv_direction.y;
+                scalar tz0 = (bounds[ray.sign[2]]->z - ray.origin.z) * ray.inv_direction.z;
+                scalar tz1 = (bounds[1 - ray.sign[2]]->z - ray.origin.z) * ray.inv_direction.z;
+
+                // Mix in the given min and max t values. Written like this, they compile to min/max instructions that also ignore a NaN t
+                t_min = tx0 > t_min ? tx0 : t_min;
+                t_min = ty0 > t_min ? ty0 : t_min;
+                t_min = tz0 > t_min ? tz0 : t_min;
+                t_max = tx1 < t_max ? tx1 : t_max;
+                t_max = ty1 < t_max ? ty1 : t_max;
+                t_max = tz1 < t_max ? tz1 : t_max;
+
+                t_enter = t_min;
+                return t_max > t_min;
+            }
 
             /* Enlarges the inner BoundingBox until it encompasses given box. */
             void merge(const BoundingBox& other);
 
             /* Returns the volume of the bounding box. */
-            double size() const;
+            scalar size() const;
+            /* Returns the surface area of the bounding box. */
+            scalar surface() const;
     };
 }
 
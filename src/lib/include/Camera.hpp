@@ -27,6 +27,7 @@
 #include "Image.hpp"
 #include "Vec3.hpp"
 #include "Ray.hpp"
+#include "Random.hpp"
 
 namespace RayTracer {
     class RenderWorld;
@@ -72,8 +73,8 @@ namespace RayTracer {
             /* Updates the camera position in the World using stored animation. */
             virtual void update(std::chrono::milliseconds time_passed);
 
-            /* Returns a ray through given u and v through the pixel grid */
-            Ray get_ray(int x, int y) const;
+            /* Returns a ray through given u and v through the pixel grid, jittered using given generator. */
+            Ray get_ray(int x, int y, Random& rng) const;
 
             /* Returns a json object with the properties of this Camera object. */
             virtual nlohmann::json to_json() const;
@@ -0,0 +1,91 @@
+/* FRAME SINK.hpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 23:10:42
+ * Last edited:
+ *   18/10/2026, 23:10:42
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   A FrameSink takes the frames of an animation one by one and turns them
+ *   into a video. The FFmpegSink streams the raw pixels over a pipe to an
+ *   ffmpeg process, which encodes them while the next frame renders, and
+ *   the Y4MSink writes them uncompressed to a YUV4MPEG2 file without
+ *   needing any external program. Neither needs temporary files. This
+ *   particular file is the header file for FrameSink.cpp.
+**/
+
+#ifndef FRAMESINK_HPP
+#define FRAMESINK_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sys/types.h>
+
+#include "Image.hpp"
+
+namespace RayTracer {
+    class FrameSink {
+        public:
+            const unsigned int width;
+            const unsigned int height;
+            const unsigned int fps;
+
+            /* The FrameSink class is the base class for everything that turns frames into a video. */
+            FrameSink(unsigned int width, unsigned int height, unsigned int fps);
+            virtual ~FrameSink() = default;
+
+            /* Adds given frame to the end of the video. Throws a runtime_error if that fails. */
+            virtual void write(const Image& frame) = 0;
+            /* Finishes the video after the last frame. Throws a runtime_error if that fails. */
+            virtual void close() = 0;
+
+            /* Opens the sink that fits the extension of given path: a Y4MSink for .y4m files, and an FFmpegSink for anything else. Throws a runtime_error if that fails. */
+            static FrameSink* open(const std::string& path, unsigned int width, unsigned int height, unsigned int fps);
+    };
+
+    class FFmpegSink : public FrameSink {
+        private:
+            /* The process ID of ffmpeg, or -1 if it isn't running. */
+            pid_t pid;
+            /* The write end of the pipe to the standard input of ffmpeg. */
+            int fd;
+            /* Buffer for one frame as raw r, g, b bytes. */
+            std::vector<unsigned char> buffer;
+
+        public:
+            /* The FFmpegSink class starts ffmpeg and streams the frames over a pipe to it as raw video, which it encodes with libx264 to given path. */
+            FFmpegSink(const std::string& path, unsigned int width, unsigned int height, unsigned int fps);
+            /* Closes the pipe if that isn't done yet, and waits for ffmpeg to quit. */
+            ~FFmpegSink();
+
+            /* Sends given frame to ffmpeg. Only blocks if ffmpeg is more than a pipe buffer behind. */
+            virtual void write(const Image& frame);
+            /* Closes the pipe and waits until ffmpeg has written the entire video. */
+            virtual void close();
+    };
+
+    class Y4MSink : public FrameSink {
+        private:
+            /* The output file. */
+            std::ofstream file;
+            /* Buffer for one row as raw r, g, b bytes. */
+            std::vector<unsigned char> rgb;
+            /* Buffer for the Y, Cb and Cr planes of one frame, after each other. */
+            std::vector<unsigned char> planes;
+
+        public:
+            /* The Y4MSink class writes the frames uncompressed as YUV 4:4:4 to a YUV4MPEG2 file, which most players and encoders read directly. */
+            Y4MSink(const std::string& path, unsigned int width, unsigned int height, unsigned int fps);
+
+            /* Converts given frame to YUV and appends it to the file. */
+            virtual void write(const Image& frame);
+            /* Flushes and closes the file. */
+            virtual void close();
+    };
+}
+
+#endif
@@ -0,0 +1,87 @@
+/* FRAME WRITER.hpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 23:52:16
+ * Last edited:
+ *   18/10/2026, 23:52:16
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   The FrameWriter class owns a small, fixed set of frame buffers that
+ *   are handed out to be rendered into, and writes the finished ones to
+ *   a FrameSink. If compiled with THREADED, the writing happens on a
+ *   background thread, so that the next frame can be rendered at the
+ *   same time; rendering only has to wait for the writer if all buffers
+ *   are in use. This particular file is the header file for
+ *   FrameWriter.cpp.
+**/
+
+#ifndef FRAMEWRITER_HPP
+#define FRAMEWRITER_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+#ifdef THREADED
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#endif
+
+#include "Image.hpp"
+#include "FrameSink.hpp"
+
+/* The default number of buffers of a FrameWriter: one to render in, one that is being written and one that waits in between. */
+#define FRAMEWRITER_BUFFERS 3
+
+namespace RayTracer {
+    class FrameWriter {
+        private:
+            /* The sink that the frames are written to. Not owned by the FrameWriter. */
+            FrameSink* sink;
+            /* All frame buffers of the writer. */
+            std::vector<Image*> buffers;
+            /* The buffers that can be rendered in. */
+            std::deque<Image*> free_buffers;
+            /* The finished frames that still have to be written, in order. */
+            std::deque<Image*> pending;
+            /* The error of the first write that failed, or empty if none did. */
+            std::string error;
+
+            #ifdef THREADED
+            /* Set when the writer thread should stop once the pending frames are written. */
+            bool stopping;
+            /* The thread that writes the pending frames. */
+            std::thread writer;
+            /* Protects free_buffers, pending, error and stopping. */
+            std::mutex lock;
+            /* Condition variable to wake up the writer thread when a frame is submitted or it should stop. */
+            std::condition_variable pending_cond;
+            /* Condition variable to wake up a thread waiting for a free buffer. */
+            std::condition_variable free_cond;
+
+            /* Writer thread function. */
+            void worker();
+            #endif
+
+            /* Writes given frame to the sink, and remembers the error if that fails. */
+            void write(Image* frame);
+
+        public:
+            /* The FrameWriter class writes frames to given sink, and recycles the given number of frame buffers of the given size for them. */
+            FrameWriter(FrameSink* sink, unsigned int width, unsigned int height, unsigned int n_buffers = FRAMEWRITER_BUFFERS);
+            /* Stops the writer thread, dropping any frames that are not written yet if close() wasn't called. */
+            ~FrameWriter();
+
+            /* Returns a free buffer to render a frame in, waiting for the writer to finish one if there is none. Note that the buffer still contains whatever frame was in it before. */
+            Image& acquire();
+            /* Queues given buffer, which must come from acquire(), to be written after all frames submitted before it. Throws a runtime_error if an earlier frame could not be written. */
+            void submit(Image& frame);
+            /* Waits until all submitted frames are written and stops the writer thread. Throws a runtime_error if any frame could not be written. */
+            void close();
+    };
+}
+
+#endif
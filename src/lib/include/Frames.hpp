@@ -4,7 +4,7 @@
  * Created:
  *   1/31/2020, 2:25:18 PM
  * Last edited:
- *   2/9/2020, 12:50:45 AM
+ *   18/10/2026, 23:24:05
  * Auto updated?
  *   Yes
  *
@@ -13,40 +13,53 @@
  *   render a little movie. In contrast to a simple list of Images, the
  *   animation also holds information about the framerate and number of
  *   frames, and can dynamically output frames while rendering to reduce
- *   the memory impact. This particular file is the header file for
- *   Frames.cpp.
+ *   the memory impact. The frames are written to a FrameSink, which turns
+ *   them into a video without any intermediate files. When writing
+ *   dynamically, a FrameWriter writes finished frames in the background
+ *   and recycles their buffers. This particular file is the header file
+ *   for Frames.cpp.
 **/
 
 #ifndef FRAMES_HPP
 #define FRAMES_HPP
 
+#include <deque>
+
 #include "Image.hpp"
+#include "FrameSink.hpp"
+#include "FrameWriter.hpp"
 
 namespace RayTracer {
     class Frames {
         private:
-            Image* current_frame;
+            /* The frames that are handed out but not finished yet, starting with the current frame. */
+            std::deque<Image*> in_flight;
+            /* All frames, if they're kept in memory. Frames that aren't handed out yet are null. */
             Image** frames;
 
             std::size_t frame_index;
-            std::string temp_dir;
             bool dynamic_writing;
 
+            /* The sink that the frames are written to. */
+            FrameSink* sink;
+            /* Writes the frames to the sink while the next ones render, if writing dynamically. Owns the frame buffers in that case. */
+            FrameWriter* writer;
+
         public:
             const unsigned int width;
             const unsigned int height;
             const unsigned int n_frames;
             const unsigned int fps;
+            /* The number of frames that may be handed out at the same time. */
+            const unsigned int frames_in_flight;
 
-            /* The animation class is used to render multiple frames, and output them as a movie. The dynamic_write boolean determines if the entire animation is saved in memory, and then to the disk (false) or if each image should be written to disk as soon it is rendered (true). Note that .to_mp4() still has to be called to create an mp4 from the images. */
-            Frames(unsigned int width, unsigned int height, unsigned int num_of_frames, unsigned int framerate, std::string temp_dir, bool dynamic_write);
-            /* Copy constructor for the Frames class. */
-            Frames(const Frames& other);
-            /* Move constructor for the Frames class. */
+            /* The animation class is used to render multiple frames, and output them as a movie at given path. A path ending in .y4m is written as an uncompressed video by the RayTracer itself, anything else is encoded by ffmpeg. The dynamic_write boolean determines if the entire animation is saved in memory, and then written (false) or if each frame should be written in the background as soon it is rendered (true). The frames_in_flight determines how many frames can be rendered at the same time. Note that .finish() still has to be called to complete the video. */
+            Frames(unsigned int width, unsigned int height, unsigned int num_of_frames, unsigned int framerate, std::string path, bool dynamic_write, unsigned int frames_in_flight = 1);
+            /* Move constructor for the Frames class. Note that there is no copy constructor, since only one Frames can write to the same video. */
             Frames(Frames&& other);
             ~Frames();
 
-            /* Finishes up this frame, and moves onto the next. */
+            /* Finishes up this frame, and moves onto the next. When writing dynamically, the next frame reuses an earlier buffer and still contains an old frame. */
             void next();
 
             /* Returns a row within the current frame. */
@@ -54,9 +67,11 @@ namespace RayTracer {
 
             /* Returns a reference to the current frame */
             Image& get_current_frame();
+            /* Returns a reference to the frame with given index, which may be up to frames_in_flight - 1 frames after the current frame so that it can be rendered before the current one is finished. Throws an out_of_range for any other frame. */
+            Image& get_frame(std::size_t index);
 
-            /* Saves the internal buffer to disk if this isn't done dynamically, and then combines all images into a .mp4. */
-            void to_mp4(std::string path);
+            /* Writes the internal buffer to the video if this isn't done dynamically, or waits until the writer is done otherwise, and then completes the video. */
+            void finish();
 
             /* Returns the current frame_index. Note that this is zero-indexed. */
             std::size_t get_frame_index() const;
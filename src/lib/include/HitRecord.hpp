@@ -21,22 +21,23 @@ namespace RayTracer {
     struct HitRecord;
 }
 
+#include <cstdint>
+
 #include "RenderObject.hpp"
-#include "Material.hpp"
 #include "Vec3.hpp"
 
 namespace RayTracer {
     class RenderObject;
-    class Material;
 
     struct HitRecord {
-        double t;
-        double t_min;
-        double t_max;
+        scalar t;
+        scalar t_min;
+        scalar t_max;
         Vec3 hitpoint;
         Vec3 normal;
         RenderObject* obj;
-        Material* material;
+        /* The index of the material in the MaterialTable of the world. */
+        uint32_t material;
     };
 }
 
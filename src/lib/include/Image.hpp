@@ -11,8 +11,10 @@
  * Description:
  *   The Image class is meant to be raw image storage. It is not much more
  *   than a wrapped 3D-array (that is allocated in 1D) with the added bonus
- *   of easy to-file features. This particular file is the header file for
- *   Image.cpp.
+ *   of easy to-file features. Next to the checked Pixel and ImageRow
+ *   access, it offers raw pointers to its rows for code that writes or
+ *   reads a lot of pixels, which are only checked if compiled with DEBUG.
+ *   This particular file is the header file for Image.cpp.
 **/
 
 #ifndef IMAGE_H
@@ -22,6 +24,7 @@
 #include <string>
 
 #include "Vec3.hpp"
+#include "PNGWriter.hpp"
 
 namespace RayTracer {
     class Pixel {
@@ -57,6 +60,9 @@ namespace RayTracer {
         private:
             /* The internal representation of the data. This is aligned as rows, then columns and then three colour values. */
             double *data;
+
+            /* Throws an out_of_range if (x, y) is not inside the image. Used by the raw access functions if compiled with DEBUG. */
+            void check(unsigned int x, unsigned int y) const;
         public:
             const unsigned int width;
             const unsigned int height;
@@ -75,8 +81,40 @@ namespace RayTracer {
             /* Provides array subscript access to a row inside the Image (which is another image) */
             ImageRow operator[](unsigned int index);
 
-            /* Saves the image to a .ppm image file. */
-            void to_png(std::string path);
+            /* Returns a pointer to all pixels in the image, stored row after row as r, g, b triplets. */
+            inline double* pixels() { return this->data; }
+            /* Returns a constant pointer to all pixels in the image, stored row after row as r, g, b triplets. */
+            inline const double* pixels() const { return this->data; }
+            /* Returns a pointer to the first pixel of given row, which is followed by the rest of the row as r, g, b triplets. Only checked if compiled with DEBUG. */
+            inline double* row(unsigned int y) {
+                #ifdef DEBUG
+                this->check(0, y);
+                #endif
+                return this->data + 3 * (std::size_t) y * this->width;
+            }
+            /* Returns a constant pointer to the first pixel of given row, which is followed by the rest of the row as r, g, b triplets. Only checked if compiled with DEBUG. */
+            inline const double* row(unsigned int y) const {
+                #ifdef DEBUG
+                this->check(0, y);
+                #endif
+                return this->data + 3 * (std::size_t) y * this->width;
+            }
+            /* Sets the pixel at (x, y) to given colour. Only checked if compiled with DEBUG. */
+            inline void set(unsigned int x, unsigned int y, const Vec3& colour) {
+                #ifdef DEBUG
+                this->check(x, y);
+                #endif
+                double* pixel = this->data + 3 * ((std::size_t) y * this->width + x);
+                pixel[0] = colour.x;
+                pixel[1] = colour.y;
+                pixel[2] = colour.z;
+            }
+
+            /* Converts given row to 8 bits per colour channel, written to out as r, g, b triplets like picture and video files store them. */
+            void row_to_bytes(unsigned int y, unsigned char* out) const;
+
+            /* Saves the image to a .png image file, compressed as given in the options. */
+            void to_png(std::string path, const PNGOptions& options = PNGOptions()) const;
     };
 }
 
@@ -116,6 +116,21 @@ namespace RayTracer {
 
 
 
+    class InvalidIndexException: public JSONException {
+        public:
+            const std::string field_name;
+            const std::size_t index;
+
+            /* Exception for when a field refers to an element in a list by its index, but the list isn't that long. */
+            InvalidIndexException(const std::string object, const std::string invalid_field_name, const std::size_t invalid_index, const std::size_t size)
+                : JSONException(object, "Field '" + invalid_field_name + "' refers to index " + std::to_string(invalid_index) + ", but there are only " + std::to_string(size) + " elements"),
+                field_name(invalid_field_name),
+                index(invalid_index)
+            {}
+    };
+
+
+
     class IOException: public JSONException {
         public:
             const std::string path;
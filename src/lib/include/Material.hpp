@@ -24,6 +24,7 @@
 
 #include "Ray.hpp"
 #include "HitRecord.hpp"
+#include "Random.hpp"
 
 namespace RayTracer {
     enum MaterialType {
@@ -54,8 +55,10 @@ namespace RayTracer {
             /* This function is meant to be implemented in the child classes of Material to allow for polymorphic copying. */
             virtual Material* clone() const = 0;
 
-            /* Computes how a ray reflects from or travels through the surface of the material. */
-            virtual bool scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out) const = 0;
+            /* Computes how a ray reflects from or travels through the surface of the material. Any randomness is drawn from given generator. */
+            virtual bool scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const = 0;
+            /* Returns whether rays that hit the material close to each other also leave it in similar directions, in which case it's worth to keep tracing them as a packet. By default, this is false. */
+            virtual bool is_coherent() const;
 
             /* Virtual for the to_json function of the Material's children */
             virtual nlohmann::json to_json() const = 0;
@@ -0,0 +1,106 @@
+/* MATERIAL TABLE.hpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 21:12:47
+ * Last edited:
+ *   18/10/2026, 21:12:47
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   The MaterialTable class stores all materials of a RenderWorld next to
+ *   each other, without any duplicates. Objects and HitRecords refer to a
+ *   material by its index in the table instead of owning a copy of their
+ *   own, and the table scatters rays with a switch on the MaterialType
+ *   instead of through the vtable. This particular file is the header
+ *   file for MaterialTable.cpp.
+**/
+
+#ifndef MATERIALTABLE_HPP
+#define MATERIALTABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <variant>
+#include <type_traits>
+#include <unordered_map>
+
+#include "json.hpp"
+#include "Material.hpp"
+#include "Lambertian.hpp"
+#include "Metal.hpp"
+#include "Dielectric.hpp"
+
+namespace RayTracer {
+    /* One material in the MaterialTable. Note that the alternatives are in the same order as the MaterialType enum. */
+    typedef std::variant<Lambertian, Metal, Dielectric> MaterialEntry;
+    // MaterialTable::type() casts the index of the alternative to a MaterialType, so make sure reordering either one doesn't compile
+    static_assert(std::is_same_v<std::variant_alternative_t<lambertian, MaterialEntry>, Lambertian>, "MaterialEntry alternatives must follow the MaterialType enum");
+    static_assert(std::is_same_v<std::variant_alternative_t<metal, MaterialEntry>, Metal>, "MaterialEntry alternatives must follow the MaterialType enum");
+    static_assert(std::is_same_v<std::variant_alternative_t<dielectric, MaterialEntry>, Dielectric>, "MaterialEntry alternatives must follow the MaterialType enum");
+    static_assert(std::variant_size_v<MaterialEntry> == dielectric + 1, "MaterialEntry must have one alternative per MaterialType");
+
+    class MaterialTable {
+        private:
+            /* The materials in the table. */
+            std::vector<MaterialEntry> entries;
+            /* Maps the json representation of every material in the table to its index, which is used to find duplicates. */
+            std::unordered_map<std::string, uint32_t> lookup;
+
+        public:
+            /* The MaterialTable class stores all materials of a world. This constructor creates an empty table. */
+            MaterialTable();
+            /* Copy constructor for the MaterialTable class. */
+            MaterialTable(const MaterialTable& other);
+            /* Move constructor for the MaterialTable class. */
+            MaterialTable(MaterialTable&& other);
+
+            /* Adds a copy of given material to the table, unless an identical one is already in there. Either way, returns the index of the material in the table. */
+            uint32_t add(const Material& material);
+
+            /* Returns the type of the material at given index. */
+            inline MaterialType type(uint32_t index) const { return (MaterialType) this->entries[index].index(); }
+            /* Returns the material at given index, which must be of type T. */
+            template <class T>
+            inline const T& get(uint32_t index) const { return *std::get_if<T>(&this->entries[index]); }
+            /* Returns the material at given index as a general Material. */
+            const Material& operator[](uint32_t index) const;
+
+            /* Computes how a ray reflects from or travels through the surface of the material at given index. Any randomness is drawn from given generator. */
+            inline bool scatter(uint32_t index, const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const {
+                const MaterialEntry& entry = this->entries[index];
+                switch (entry.index()) {
+                    case lambertian:
+                        return std::get_if<Lambertian>(&entry)->Lambertian::scatter(ray_in, record, attenuation, ray_out, rng);
+                    case metal:
+                        return std::get_if<Metal>(&entry)->Metal::scatter(ray_in, record, attenuation, ray_out, rng);
+                    default:
+                        return std::get_if<Dielectric>(&entry)->Dielectric::scatter(ray_in, record, attenuation, ray_out, rng);
+                }
+            }
+            /* Returns whether the material at given index keeps rays that hit it close to each other together. */
+            bool is_coherent(uint32_t index) const;
+
+            /* Returns the number of materials in the table. */
+            inline std::size_t size() const { return this->entries.size(); }
+
+            /* Copy assignment operator for the MaterialTable class. */
+            MaterialTable& operator=(MaterialTable other);
+            /* Move assignment operator for the MaterialTable class. */
+            MaterialTable& operator=(MaterialTable&& other);
+            /* Swap operator for the MaterialTable class. */
+            friend void swap(MaterialTable& first, MaterialTable& second);
+
+            /* Returns a json array with all materials in the table, in order. */
+            nlohmann::json to_json() const;
+            /* Returns a new MaterialTable with the materials in given json array. The materials are added as-is, so that they keep the index they have in the array. */
+            static MaterialTable from_json(nlohmann::json json_obj);
+    };
+
+    /* Swap operator for the MaterialTable class. */
+    void swap(MaterialTable& first, MaterialTable& second);
+}
+
+#endif
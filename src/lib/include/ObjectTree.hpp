@@ -13,119 +13,145 @@
  *   efficiently-searchable way. To facilitate moving spheres, the adding
  *   of the spheres is done in a dumb way, but with optimize() they are
  *   shuffled in the most optimal way.
- *   The most optimal way here is defined as //TBD
+ *   The tree itself is a flattened bounding volume hierarchy: all nodes
+ *   live in one contiguous vector in depth-first order, where the left
+ *   child of a branch always directly follows it and the right child is
+ *   found by offset. Leaves refer to a range of objects instead, which
+ *   are hit all at once with a SIMD kernel if they are spheres.
+ *   Optionally, the binary tree is collapsed into a wide tree with four
+ *   or eight children per node, whose child boxes are stored per
+ *   component so that all of them are hit by a ray at once.
+ *   Coherent rays, like the primary rays of neighbouring pixels, can also
+ *   be traced as a packet through the binary tree, which tests every box
+ *   with all rays in the packet at once.
 **/
 
 #ifndef OBJECTTREE_HPP
 #define OBJECTTREE_HPP
 
+#include <string>
 #include <vector>
+#include <cstdint>
 
 #include "RenderObject.hpp"
 #include "HitRecord.hpp"
+#include "BoundingBox.hpp"
+#include "SphereStore.hpp"
 #include "Ray.hpp"
 
+/* The maximum depth of the traversal stack used by ObjectTree::hit(). */
+#define OBJECTTREE_STACK_SIZE 64
+/* The minimum number of objects in a subtree before optimize() builds it on a separate thread. */
+#define OBJECTTREE_PARALLEL_THRESHOLD 1024
+/* The largest number of children a node of a wide tree can have. */
+#define OBJECTTREE_MAX_WIDTH 8
+/* The largest number of rays that ObjectTree::hit_packet() can trace at once. */
+#define OBJECTTREE_MAX_PACKET 16
+
 namespace RayTracer {
-    class ObjectTreeNode {
-        protected:
-            ObjectTreeNode(bool is_leaf, BoundingBox box) :is_leaf(is_leaf), box(box) {};
-        public:
-            /* Signifies if the node is a leaf node or not. */
-            bool is_leaf;
-            /* The BoundingBox of the branch for quick hitting. */
-            BoundingBox box;
+    enum ObjectTreeStrategy {
+        median_split,
+        binned_sah
+    };
+    static std::string ObjectTreeStrategyNames[] = {
+        "median",
+        "sah"
+    };
 
-            /* Overridable deconstructor */
-            virtual ~ObjectTreeNode() {};
+    struct ObjectTreeOptions {
+        /* The strategy used by optimize() to split the objects. */
+        ObjectTreeStrategy strategy = binned_sah;
+        /* The number of bins per axis used by the binned_sah strategy. */
+        unsigned int n_bins = 16;
+        /* The maximum number of objects in one leaf. Note that the binned_sah strategy may still decide to split smaller ranges if that is cheaper. */
+        unsigned int max_leaf_size = 4;
+        /* If true, hit() visits the nearest child of a branch first and skips any subtree that starts behind the closest hit so far. Otherwise, the left child is always visited first. */
+        bool ordered_traversal = true;
+        /* The number of threads that optimize() may use to build subtrees in parallel. Only used if compiled with THREADED. */
+        unsigned int n_threads = 1;
+        /* If true, RenderWorld::update() refits the existing tree to the moved objects instead of rebuilding it. */
+        bool refit = true;
+        /* refit() falls back to a full rebuild once the cost of the tree exceeds its cost after the last build by this factor. */
+        double rebuild_threshold = 1.5;
+        /* The number of children per node used by hit(). Can be 2 for the binary tree itself, or 4 or 8 to collapse the binary tree into a wide tree. */
+        unsigned int width = 2;
+    };
 
-            /* Quick hit check to see if the bounding box is hit. */
-            virtual bool quick_hit(const Ray& ray, double t_min, double t_max) const = 0;
-            /* Virtual for the hit function of a node. Returns the RenderObject it hits, or nullptr if nothing is hit. */
-            virtual bool hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const = 0;
+    struct ObjectTreeNode {
+        /* The BoundingBox of the node for quick hitting. */
+        BoundingBox box;
+        /* For branches, the index of the right child in the node list (the left child is always the next node). For leaves, the index of the first object in the ordered object list. */
+        uint32_t offset;
+        /* The number of objects in this node if it is a leaf, or 0 if it is a branch. */
+        uint32_t n_objects;
 
-            /* Virtual clone function. Note that this allocates a new ObjectTreeNode. */
-            virtual ObjectTreeNode* clone() const = 0;
+        /* Returns whether this node is a leaf node or not. */
+        inline bool is_leaf() const { return this->n_objects > 0; }
     };
 
-    class ObjectTreeBranch: public ObjectTreeNode {
-        private:
-            /* The left node in the tree. */
-            ObjectTreeNode* left;
-            /* The right node in the tree. */
-            ObjectTreeNode* right;
-        public:
-            /* The ObjectTreeBranch is a node that branches into two subtrees. More concretely, it represents a hitbox over multiple RenderObject. */
-            ObjectTreeBranch(const std::vector<RenderObject*> elements);
-            /* Copy constructor for ObjectTreeBranch. */
-            ObjectTreeBranch(const ObjectTreeBranch& other);
-            /* Move constructor for ObjectTreeBranch. */
-            ObjectTreeBranch(ObjectTreeBranch&& other);
-            /* Deconstructor for the ObjectTreeBranch. */
-            ~ObjectTreeBranch();
-
-            /* Quick hit check to see if the bounding box is hit. */
-            virtual bool quick_hit(const Ray& ray, double t_min, double t_max) const;
-            /* Returns if either of the leaf nodes is hit. */
-            virtual bool hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const;
-
-            /* Copy assignment operator for the ObjectTreeBranch. */
-            ObjectTreeBranch& operator=(ObjectTreeBranch other);
-            /* Move assignment operator for the ObjectTreeBranch. */
-            ObjectTreeBranch& operator=(ObjectTreeBranch&& other);
-            /* Swap operator for ObjectTreeBranch. */
-            friend void swap(ObjectTreeBranch& first, ObjectTreeBranch& second);
-
-            /* Clones this ObjectTreeBranch and allocates a new one. */
-            virtual ObjectTreeNode* clone() const;
-    };
-    
-    class ObjectTreeLeaf: public ObjectTreeNode {
-        private:
-            /* The RenderObject represented by this node. */
-            RenderObject* obj;
-        public:
-            /* The ObjectTreeLeaf is the node that stores the RenderObjects. More concretely, it represents only the hitbox of one RenderObject. */
-            ObjectTreeLeaf(RenderObject* obj);
-            /* Copy constructor for ObjectTreeLeaf. */
-            ObjectTreeLeaf(const ObjectTreeLeaf& other);
-            /* Move constructor for ObjectTreeLeaf. */
-            ObjectTreeLeaf(ObjectTreeLeaf&& other);
-            /* Deconstructor for ObjectTreeLeaf. */
-            ~ObjectTreeLeaf();
-
-            /* Quick hit check to see if the bounding box is hit. */
-            virtual bool quick_hit(const Ray& ray, double t_min, double t_max) const;
-            /* Returns whether the inner object is hit, and stores a reference to it in hitrecord. */
-            virtual bool hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const;
-
-            /* Copy assignment operator for the ObjectTreeLeaf. */
-            ObjectTreeLeaf& operator=(ObjectTreeLeaf other);
-            /* Move assignment operator for the ObjectTreeLeaf. */
-            ObjectTreeLeaf& operator=(ObjectTreeLeaf&& other);
-            /* Swap operator for ObjectTreeLeaf. */
-            friend void swap(ObjectTreeLeaf& first, ObjectTreeLeaf& second);
-
-            /* Clones this ObjectTreeBranch and allocates a new one. */
-            virtual ObjectTreeNode* clone() const;
+    template <unsigned int W>
+    struct alignas(32) ObjectTreeWideNode {
+        /* The lower corners of the boxes of the children, per component. */
+        scalar min_x[W], min_y[W], min_z[W];
+        /* The upper corners of the boxes of the children, per component. */
+        scalar max_x[W], max_y[W], max_z[W];
+        /* For children that are branches, their index in the wide node list. For leaves, the index of their first object in the ordered object list. */
+        uint32_t offset[W];
+        /* The number of objects of each child if it is a leaf, or 0 if it is a branch. */
+        uint32_t n_objects[W];
+        /* The number of children in use. Unused slots have an inverted box, so that they are never hit. */
+        uint32_t n_children;
     };
 
     class ObjectTree {
         private:
             /* A linear vector of RenderObject that allow the repeated construction of the tree. */
             std::vector<RenderObject*> objects;
-
-            /* The root of the tree. */
-            ObjectTreeNode* root;
+            /* The same objects as above, but ordered such that each leaf references a contiguous range. */
+            std::vector<RenderObject*> ordered;
+            /* The nodes of the tree, stored in depth-first order. The first node is the root. */
+            std::vector<ObjectTreeNode> nodes;
+            /* The binary tree collapsed into nodes with four children, if options.width is 4. */
+            std::vector<ObjectTreeWideNode<4>> nodes4;
+            /* The binary tree collapsed into nodes with eight children, if options.width is 8. */
+            std::vector<ObjectTreeWideNode<8>> nodes8;
+            /* Packed copies of the spheres in the ordered list, used to hit leaves with multiple objects at once. */
+            SphereStore spheres;
 
             /* Represents if the tree is optimised or not. */
             bool is_optimised;
 
             /* Keeps track of the uids. */
             size_t uid;
+
+            /* Determines how the tree is built. */
+            ObjectTreeOptions options;
+            /* The cost of the tree right after it was last built by optimize(). */
+            double built_cost;
+
+            /* Splits the given range of the ordered list using the Surface Area Heuristic. Partitions the range in-place and returns the index of the split, or the end of the range if a leaf is cheaper. */
+            size_t split_sah(size_t start, size_t end, const BoundingBox& box);
+            /* Recursively builds the node for the given range of the ordered list into the given node list, and returns its index in that list. */
+            uint32_t build(std::vector<ObjectTreeNode>& nodes, size_t start, size_t end, unsigned int depth);
+            /* Recursively collapses the binary node at given index into a wide node with at most W children, appending it and its descendants to given list. Returns its index in that list. */
+            template <unsigned int W>
+            uint32_t collapse(std::vector<ObjectTreeWideNode<W>>& wide, uint32_t index) const;
+            /* Collapses the binary tree into the wide tree selected by options.width, if any. */
+            void collapse_all();
+
+            /* Hits all objects in given leaf range, shrinking t_best whenever a closer hit is found. */
+            inline bool hit_leaf(uint32_t offset, uint32_t n_objects, const Ray& ray, scalar t_min, scalar& t_best, HitRecord& record) const;
+            /* Traverses the optimised tree, always visiting the left child before the right child. */
+            bool hit_unordered(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const;
+            /* Traverses the optimised tree, visiting the nearest child first and skipping subtrees that start behind the closest hit so far. */
+            bool hit_ordered(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const;
+            /* Traverses the wide tree, hitting all children of a node at once. If options.ordered_traversal is set, the children are visited nearest first. */
+            template <unsigned int W>
+            bool hit_wide(const std::vector<ObjectTreeWideNode<W>>& wide, const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const;
         public:
             /* The ObjectTree provides optimized ray hitting with the objects inside. This is the default constructor. */
             ObjectTree();
-            /* Copy constructor for the ObjectTree */
+            /* Copy constructor for the ObjectTree. The objects are cloned, so the copy stays the same when the objects of the original are updated. */
             ObjectTree(const ObjectTree& other);
             /* Move constructor for the ObjectTree */
             ObjectTree(ObjectTree&& other);
@@ -137,15 +163,26 @@ namespace RayTracer {
             /* Remove a RenderObject. Returns true if succesfull, or false if not (if the obj doesn't exist, for example). This overload finds the object by pointer. */
             bool remove(RenderObject* obj);
 
+            /* Changes how the tree is built. Note that this does not rebuild the tree, so call optimize() afterwards. */
+            void set_options(const ObjectTreeOptions& options);
+            /* Returns the options used to build the tree. */
+            const ObjectTreeOptions& get_options() const;
+
             /* Optimize the current tree. */
             void optimize();
+            /* Recomputes the boxes of the current tree bottom-up without changing its structure, for when objects have moved. If the tree isn't optimised or its quality degraded too much, optimize() is called instead. Returns whether the tree was refitted (true) or rebuilt (false). */
+            bool refit();
+            /* Returns the expected cost of hitting a ray with the optimised tree according to the Surface Area Heuristic. */
+            double cost() const;
 
             /* Hit a ray with the tree, and return a reference to the closest hit. Returns if hit. Note that it performs a dready loop-traversal if the tree is not optimised. */
-            bool hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const;
+            bool hit(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const;
+            /* Hits n rays with the tree at once, sharing one traversal of the binary tree between them. More than OBJECTTREE_MAX_PACKET rays are traced in chunks of that size. For every ray, hits[i] tells whether it hit something and records[i] describes the closest hit, just like hit() would. Works best if the rays are coherent, i.e., start close together and point in similar directions. */
+            void hit_packet(const Ray* rays, unsigned int n, scalar t_min, scalar t_max, HitRecord* records, bool* hits) const;
 
-            /* Copy assignment operator for the ObjectTreeLeaf. */
+            /* Copy assignment operator for the ObjectTree. */
             ObjectTree& operator=(ObjectTree other);
-            /* Move assignment operator for the ObjectTreeLeaf. */
+            /* Move assignment operator for the ObjectTree. */
             ObjectTree& operator=(ObjectTree&& other);
             /* Swap operator for ObjectTree. */
             friend void swap(ObjectTree& first, ObjectTree& second);
@@ -155,14 +192,12 @@ namespace RayTracer {
 
             /* Returns the number of elements in the tree. */
             size_t size() const;
+            /* Returns the number of nodes in the optimised tree. */
+            size_t n_nodes() const;
     };
 
-    /* Swap operator for ObjectTreeBranch. */
-    void swap(ObjectTreeBranch& first, ObjectTreeBranch& second);
-    /* Swap operator for ObjectTreeLeaf. */
-    void swap(ObjectTreeLeaf& first, ObjectTreeLeaf& second);
     /* Swap operator for ObjectTree. */
     void swap(ObjectTree& first, ObjectTree& second);
 }
 
-#endif
\ No newline at end of file
+#endif
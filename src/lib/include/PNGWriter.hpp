@@ -0,0 +1,43 @@
+/* PNG WRITER.hpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 22:04:19
+ * Last edited:
+ *   18/10/2026, 22:04:19
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   Writes Images to PNG files. The image is cut into bands of rows,
+ *   which are converted to bytes, filtered and compressed independently
+ *   of each other, so that they can be spread over multiple threads if
+ *   compiled with THREADED. Every band ends with a zlib sync flush, which
+ *   lets the bands be concatenated into one valid deflate stream. The
+ *   bands are written to the file in order as soon as they are done.
+ *   This particular file is the header file for PNGWriter.cpp.
+**/
+
+#ifndef PNGWRITER_HPP
+#define PNGWRITER_HPP
+
+#include <string>
+
+/* The number of bytes of image data that is roughly put in one band. */
+#define PNGWRITER_BAND_SIZE (256 * 1024)
+
+namespace RayTracer {
+    class Image;
+
+    struct PNGOptions {
+        /* The zlib compression level, from 0 (no compression) to 9 (best compression). Level 1 is a lot faster, which is useful for previews. */
+        int level = 6;
+        /* The number of threads that compress bands at the same time. Ignored if not compiled with THREADED. */
+        unsigned int n_threads = 1;
+    };
+
+    /* Writes given image to a PNG file at given path, with a colour depth of 8 bits per channel. Throws a runtime_error if that fails. */
+    void write_png(const Image& image, const std::string& path, const PNGOptions& options = PNGOptions());
+}
+
+#endif
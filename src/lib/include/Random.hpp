@@ -4,28 +4,69 @@
  * Created:
  *   1/22/2020, 3:20:21 PM
  * Last edited:
- *   1/29/2020, 11:44:18 AM
+ *   18/10/2026, 16:20:05
  * Auto updated?
  *   Yes
  *
  * Description:
  *   This file harbours a simpel random function, that can generate random
- *   doubles within 0.0 to 1.0. This particular file is the header file for
+ *   doubles within 0.0 to 1.0. The renderer itself uses the Random class
+ *   instead, which is a small xoshiro256+ generator that is owned and
+ *   passed around by whoever renders a pixel, so that threads never share
+ *   any random state. This particular file is the header file for
  *   Random.cpp.
 **/
 
 #ifndef RANDOM_HPP
 #define RANDOM_HPP
 
+#include <cstdint>
+
 #include "Vec3.hpp"
 
 namespace RayTracer {
-    /* Generates a random double such that 0 <= x < 1 */
+    class Random {
+        private:
+            /* The state of the xoshiro256+ generator. */
+            uint64_t state[4];
+
+            /* Rotates given value left by k bits. */
+            static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+        public:
+            /* The Random class is a fast, non-shared random number generator. This constructor seeds it with given seed, and optionally a stream number so that, for example, every pixel can get its own sequence from the same seed. */
+            Random(uint64_t seed = 0, uint64_t stream = 0);
+
+            /* Reseeds the generator, just like the constructor does. */
+            void seed(uint64_t seed, uint64_t stream = 0);
+
+            /* Returns the next random 64-bit integer. */
+            inline uint64_t next() {
+                uint64_t result = this->state[0] + this->state[3];
+                uint64_t t = this->state[1] << 17;
+                this->state[2] ^= this->state[0];
+                this->state[3] ^= this->state[1];
+                this->state[1] ^= this->state[2];
+                this->state[0] ^= this->state[3];
+                this->state[2] ^= t;
+                this->state[3] = rotl(this->state[3], 45);
+                return result;
+            }
+            /* Returns the next random double such that 0 <= x < 1. */
+            inline double next_double() { return (this->next() >> 11) * 0x1.0p-53; }
+    };
+
+    /* Generates a random double such that 0 <= x < 1, using a generator private to the calling thread. Meant for building scenes; rendering code should pass its own Random instead. */
     double random_double();
+    /* Generates a random double such that 0 <= x < 1 using given generator. */
+    inline double random_double(Random& rng) { return rng.next_double(); }
     /* Generates a vector randomly in the unit sphere. Uses a rather ugly method that has undertermined runtime. */
     Vec3 random_in_unit_sphere();
+    /* Generates a vector randomly in the unit sphere using given generator. */
+    Vec3 random_in_unit_sphere(Random& rng);
     /* Generates a vector randomly in the unit disc. Basically random_in_unit_sphere() except in 2D. */
     Vec3 random_in_unit_disc();
+    /* Generates a vector randomly in the unit disc using given generator. */
+    Vec3 random_in_unit_disc(Random& rng);
 }
 
-#endif
\ No newline at end of file
+#endif
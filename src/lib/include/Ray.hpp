@@ -9,8 +9,11 @@
  *   Yes
  *
  * Description:
- *   The Ray class represent a ray in the 3D space. This particular file is
- *   the header file for Ray.cpp.
+ *   The Ray class represent a ray in the 3D space. Besides its origin and
+ *   direction, it carries the inverse of its direction and the sign of
+ *   each component, so that every box it is tested against doesn't have
+ *   to compute them again. This particular file is the header file for
+ *   Ray.cpp.
 **/
 
 #ifndef RAY_HPP
@@ -23,14 +26,18 @@ namespace RayTracer {
         public:
             Vec3 origin;
             Vec3 direction;
+            /* One divided by the direction, per component. Computed by the constructor, so don't change the direction of an existing Ray. */
+            Vec3 inv_direction;
+            /* Per component, 1 if the direction is negative and 0 otherwise. A ray enters a box through the side given by this (the upper side for 1), and leaves it through the other. */
+            int sign[3];
 
             /* The Ray class represents a light ray in the 3D space. The default initializer initializes the Ray with origin & direction (0,0,0). */
             Ray();
-            /* The Ray class represents a light ray in the 3D space. This initializer initializes the Ray with given origin and direction. */
+            /* The Ray class represents a light ray in the 3D space. This initializer initializes the Ray with given origin and direction, and precomputes the inverse direction and its signs. */
             Ray(const Vec3& origin, const Vec3& direction);
 
             /* Returns a point along the Ray with distance t from the origin. */
-            Vec3 point(double t) const;
+            Vec3 point(scalar t) const;
     };
 }
 
@@ -25,12 +25,12 @@
 #include "Vec3.hpp"
 #include "Ray.hpp"
 #include "HitRecord.hpp"
-#include "Material.hpp"
 #include "RenderAnimation.hpp"
 #include "BoundingBox.hpp"
 
 namespace RayTracer {
     class RenderAnimation;
+    class MaterialTable;
 
     enum RenderObjectType {
         sphere,
@@ -63,12 +63,12 @@ namespace RayTracer {
             virtual RenderObject* clone() const = 0;
 
             /* A quick check if the bounding box of the object has been hit by a ray. The bounding box limits should be computed at the object's init. Note that the normal hit function is needed for more accuracy. */
-            virtual bool quick_hit(const Ray& ray, double t_min, double t_max) const;
+            virtual bool quick_hit(const Ray& ray, scalar t_min, scalar t_max) const;
             /* Virtual for the derived classes to recompute the hit boxes. */
             virtual bool compute_hit_box() = 0;
 
             /* Virtual for the derived classes to determine whether they have been hit by a ray or not. */
-            virtual bool hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const = 0;
+            virtual bool hit(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const = 0;
 
             /* Virtual for the derived classes to return the colour associated with the hit position. */
             virtual Vec3 colour(const HitRecord& record) const = 0;
@@ -83,8 +83,8 @@ namespace RayTracer {
 
             /* Virtual for the derived classes to implement a custom to_json function. */
             virtual nlohmann::json to_json() const = 0;
-            /* Static function that gets a derived material class from given json object. Note that the returned value is allocated and will have to be deallocated. */
-            static RenderObject* from_json(nlohmann::json json_obj);
+            /* Static function that gets a derived material class from given json object. Any materials it uses are looked up in or added to given table. Note that the returned value is allocated and will have to be deallocated. */
+            static RenderObject* from_json(nlohmann::json json_obj, MaterialTable& materials);
     };
 }
 
@@ -28,14 +28,62 @@
 #include "Vec3.hpp"
 #include "RenderObject.hpp"
 #include "ObjectTree.hpp"
+#include "MaterialTable.hpp"
 #include "Camera.hpp"
+#include "Random.hpp"
+#include "Tiles.hpp"
+#include "Image.hpp"
 #include "RenderAnimation.hpp"
 
 namespace RayTracer {
+    struct IntegratorOptions {
+        /* The maximum number of times a ray may bounce before it's considered absorbed. */
+        unsigned int max_depth = 50;
+        /* If true, paths are randomly terminated with a probability based on how much light they can still carry, and the surviving paths are weighted up to compensate. */
+        bool russian_roulette = false;
+        /* The number of bounces after which russian roulette may start terminating paths. */
+        unsigned int min_depth = 3;
+        /* The highest probability with which russian roulette lets a path survive. Keeping this below one makes sure that paths that lose no light, like those inside glass, are terminated as well. */
+        double max_survival = 0.95;
+        /* The number of neighbouring pixels whose rays are traced together as a packet by render_tile(). Can be 4, 8 or 16, or 1 to trace every ray on its own. */
+        unsigned int packet_size = 1;
+        /* If not zero, render_tile() keeps up to this many paths in flight at once, and moves them through the world one bounce at a time with the rays sorted by material. Takes precedence over the packet size. */
+        unsigned int wavefront_size = 0;
+    };
+
+    struct PixelStats {
+        /* The running mean of the samples per colour channel. */
+        double mean[3] = { 0, 0, 0 };
+        /* The running sum of squared distances to the mean per colour channel, as in Welford's algorithm. */
+        double m2[3] = { 0, 0, 0 };
+        /* The number of samples taken so far. */
+        uint32_t n = 0;
+
+        /* Adds one sample to the statistics. */
+        void add(const Vec3& sample);
+        /* Returns whether the standard error of the mean is at most threshold relative to the brightness of the pixel, in every channel. Always false for less than two samples. */
+        bool converged(double threshold) const;
+        /* Returns the mean colour, optionally gamma-corrected. */
+        Vec3 colour(bool gamma) const;
+    };
+
     class RenderWorld {
         private:
             /* Optimisable list that stores the RenderObjects in the world. */
             ObjectTree* objects;
+            /* The materials used by the objects in the world. */
+            MaterialTable materials;
+            /* Determines how rays are bounced through the world. */
+            IntegratorOptions integrator;
+
+            /* Does one step of a path: given a ray, whether it hit anything (and if so, where), the number of bounces so far and the fraction of light that can still reach the camera, either ends the path by setting colour and returning false, or sets the next ray and updated throughput and returns true. */
+            bool bounce(const Ray& ray, bool hit, const HitRecord& record, unsigned int depth, Vec3& throughput, Ray& next, Vec3& colour, Random& rng) const;
+            /* Follows given ray through the world until its path ends, continuing a path that already made depth bounces and has given throughput. Returns the colour it ends up with. */
+            Vec3 follow_ray(const Ray& ray, unsigned int depth, Vec3 throughput, Random& rng) const;
+            /* Traces the n given rays as a packet while they stay coherent, i.e., as long as they all bounce off coherent materials, after which they're followed one by one. Every ray draws from its own generator, and its final colour is stored in colours. */
+            void trace_packet(const Ray* rays, Random* rngs, unsigned int n, Vec3* colours) const;
+            /* Renders given tile by keeping all of its samples in flight as a wavefront: every step, all rays are intersected with the world, sorted by the material they hit, and shaded material by material. */
+            void render_tile_wavefront(const Tile& tile, const Camera& cam, Image& out, uint64_t seed) const;
         public:
             /* The RenderWorld class describes the world, and serves as the root for the object hiearchy. */
             RenderWorld();
@@ -47,20 +95,34 @@ namespace RayTracer {
 
             /* Adds a RenderObject to the world. Note that anything added this way will be deallocated automatically. */
             void add_object(RenderObject* obj);
+            /* Adds a copy of given material to the world, and returns the index with which objects can refer to it. Adding the same material twice gives the same index. */
+            uint32_t add_material(const Material& material);
+            /* Returns the table with all materials in the world. */
+            const MaterialTable& get_materials() const;
 
             /* Returns the number of objects defined in the RenderWorld. */
             std::size_t get_object_count() const;
 
-            /* Computes the colour of a shot ray. The depth variable makes sure that, in the case of very reflective surfaces, we only do this at max 50 times. */
-            Vec3 bounce_ray(const Ray& ray, int depth=0) const;
-            /* Renders one pixel instead by shooting rays and everything. The optional cam_index can be used to render from another camera if there are multiple given. The index is equal to the order the cameras were added. */
-            Vec3 render_pixel(int x, int y, const Camera& cam) const;
+            /* Computes the colour of a shot ray by following it as it bounces through the world, drawing any randomness from given generator. The path ends when it hits the sky, is absorbed, exceeds the maximum depth or is killed by russian roulette. */
+            Vec3 bounce_ray(const Ray& ray, Random& rng) const;
+            /* Renders one pixel instead by shooting rays and everything. Every sample gets its own random generator based on the seed, the position of the pixel and the sample number, so its colour does not depend on which thread renders it or when. */
+            Vec3 render_pixel(int x, int y, const Camera& cam, uint64_t seed=0) const;
+            /* Shoots n_samples more rays through the given pixel and adds them to its statistics. The random streams continue where the previous call left off, so sampling in several steps gives the same result as sampling at once. */
+            void sample_pixel(int x, int y, const Camera& cam, uint64_t seed, PixelStats& stats, uint32_t n_samples) const;
+            /* Renders all pixels in given tile with render_pixel(), and writes them to the given image. If a packet size is set, blocks of neighbouring pixels are traced as packets instead, and if a wavefront size is set, the whole tile is traced as a wavefront; both give the exact same image. */
+            void render_tile(const Tile& tile, const Camera& cam, Image& out, uint64_t seed=0) const;
 
             /* Updates all animations in the RenderWorld */
             void update(std::chrono::milliseconds time_passed);
 
             /* Wraps the internal optimize function of the ObjectTree. */
             void optimize();
+            /* Changes how the internal ObjectTree is built, and rebuilds it using these options. */
+            void set_tree_options(const ObjectTreeOptions& options);
+            /* Changes how rays are bounced through the world. */
+            void set_integrator_options(const IntegratorOptions& options);
+            /* Returns the options that determine how rays are bounced through the world. */
+            const IntegratorOptions& get_integrator_options() const;
 
             /* Copy assignment operator for the RenderWorld class. */
             RenderWorld& operator=(RenderWorld other);
@@ -72,8 +134,8 @@ namespace RayTracer {
 
             /* Returns a json object representing this RenderWorld and all RenderObjects, RenderLights and RenderAnimations stored in it. */
             virtual nlohmann::json to_json() const;
-            /* Returns a new RenderWorld based on the given json file. Note that this new world will have to be deallocated later on. */
-            static RenderWorld* from_json(nlohmann::json json_obj);
+            /* Returns a new RenderWorld based on the given json file. Any integrator settings that aren't given in the file are taken from the given options. Note that this new world will have to be deallocated later on. */
+            static RenderWorld* from_json(nlohmann::json json_obj, const IntegratorOptions& integrator = IntegratorOptions());
     };
 
     /* Swap operator for the RenderWorld class. */
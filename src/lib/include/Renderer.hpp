@@ -20,25 +20,65 @@
 #define RENDERER_HPP
 
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
 
+#ifdef THREADED
+#include "ThreadPool.hpp"
+#endif
+#include "ProgressBar.hpp"
 #include "Frames.hpp"
 #include "RenderWorld.hpp"
 #include "Camera.hpp"
+#include "Tiles.hpp"
 
 namespace RayTracer {
     class Renderer {
+        private:
+            #ifdef THREADED
+            /* The pool used by the render function that is currently running. */
+            ThreadPool* pool;
+            #endif
+
+            /* Runs the given job on every given tile, on all threads if compiled with THREADED, and waits until it is done. If a progressbar is given, it is updated with the number of pixels done. */
+            void run_tiles(const std::vector<Tile>& tiles, const std::function<void(const Tile&)>& job, std::ProgressBar* prgrs) const;
+            /* Renders one image with the given seed, either with a fixed number of rays per pixel or adaptively. */
+            void render_frame(RenderWorld* world, Camera* cam, Image& out, uint64_t seed, const std::vector<Tile>& tiles, std::ProgressBar& prgrs) const;
+            /* Renders one image in passes, where every pass only shoots more rays through the pixels that aren't converged yet. On average, pixels get no more than cam->rays rays. */
+            void render_adaptive(RenderWorld* world, Camera* cam, Image& out, uint64_t seed, const std::vector<Tile>& tiles, std::ProgressBar& prgrs) const;
+            #ifdef THREADED
+            /* Renders an animation with up to out.frames_in_flight frames in the pool at once. Every frame is rendered with its own copy of the world and camera, so that they can be updated for the next frame while earlier frames are still rendering. */
+            void render_pipelined(RenderWorld* world, Camera* cam, Frames& out, const std::vector<Tile>& tiles);
+            #endif
         public:
             int n_threads;
-            int batch_size;
+            /* The width of the tiles that the image is split into. */
+            unsigned int tile_width;
+            /* The height of the tiles that the image is split into. */
+            unsigned int tile_height;
+            /* The order in which the tiles are rendered. */
+            TileOrder tile_order;
             bool show_progressbar;
+            /* The seed from which the random stream of every pixel is derived. */
+            uint64_t seed;
+            /* If larger than 0, pixels are sampled adaptively until the standard error of their mean is at most this fraction of their brightness. */
+            double noise_threshold;
+            /* The number of rays every pixel gets before deciding whether it's converged when sampling adaptively. */
+            unsigned int min_rays;
+            /* The maximum number of rays a single pixel can get when sampling adaptively, or 0 for four times the camera's number of rays. */
+            unsigned int max_rays;
+
+            /* The Renderer class provides a more structures split between the prepration of the rendering and the rendering itself. The seed determines the noise in the image, which is the same for any number of threads, tile size or tile order. */
+            Renderer(int num_of_threads, unsigned int tile_width, unsigned int tile_height, TileOrder tile_order, bool show_progressbar, uint64_t seed=0);
 
-            /* The Renderer class provides a more structures split between the prepration of the rendering and the rendering itself. */
-            Renderer(int num_of_threads, int batch_size, bool show_progressbar);
+            /* Enables adaptive sampling if the noise threshold is larger than 0. The total number of rays stays the same as without, but they are moved from converged pixels to noisy ones. */
+            void set_adaptive(double noise_threshold, unsigned int min_rays=16, unsigned int max_rays=0);
 
             /* The render function renders a given world for you, either threaded or non-threaded (depends on how it is compiled) */
             Image render(RenderWorld* world, Camera* cam);
 
-            /* This render function renders a whole series of Images. Before rendering a new one, the renderworld.update() method is called to update all objects. */
+            /* This render function renders a whole series of Images. Before rendering a new one, the renderworld.update() method is called to update all objects. Every frame gets its own seed, derived from the Renderer's seed and the frame number. If compiled with THREADED and the Frames allow more than one frame in flight, the next frames are started before the current one is done. */
             void render_animation(RenderWorld* world, Camera* cam, Frames& out);
     };
 }
@@ -0,0 +1,40 @@
+/* SCALAR.hpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 19:02:37
+ * Last edited:
+ *   18/10/2026, 19:02:37
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   Defines the scalar type used by the core math of the renderer, i.e.,
+ *   the vectors, rays, bounding boxes, objects and the object tree. By
+ *   default this is a double, but if compiled with FLOAT32 it becomes a
+ *   float, which makes the SIMD kernels twice as wide and halves the
+ *   memory they use at the cost of precision. Since colours are Vec3s
+ *   too, the per-pixel colour sums, the material albedos and the camera
+ *   basis follow the scalar type as well; only the running statistics
+ *   of adaptive sampling and the camera's angles and lens radius are
+ *   always kept in doubles.
+**/
+
+#ifndef SCALAR_HPP
+#define SCALAR_HPP
+
+namespace RayTracer {
+    #ifdef FLOAT32
+    /* The type used for all coordinates and distances. */
+    typedef float scalar;
+    /* The smallest distance along a ray at which a hit counts, which prevents a bounced ray from hitting the surface it starts on due to rounding errors. */
+    #define SCALAR_T_MIN 1e-4f
+    #else
+    /* The type used for all coordinates and distances. */
+    typedef double scalar;
+    /* The smallest distance along a ray at which a hit counts, which prevents a bounced ray from hitting the surface it starts on due to rounding errors. */
+    #define SCALAR_T_MIN 1e-8
+    #endif
+}
+
+#endif
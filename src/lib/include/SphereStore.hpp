@@ -0,0 +1,105 @@
+/* SPHERE STORE.hpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 15:10:42
+ * Last edited:
+ *   18/10/2026, 15:10:42
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   The SphereStore class keeps a packed copy of the centers, radii and
+ *   material indices of a list of RenderObjects, stored as separate,
+ *   aligned arrays per component. This allows the ObjectTree to hit a ray
+ *   with several spheres at once using SIMD instructions (AVX if compiled
+ *   with it, otherwise SSE2, or SSE for floats); floats with AVX test
+ *   eight spheres at once. Objects that aren't spheres get a NaN radius
+ *   so that they are never hit. This particular file is the header file
+ *   for SphereStore.cpp.
+**/
+
+#ifndef SPHERESTORE_HPP
+#define SPHERESTORE_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+#include "RenderObject.hpp"
+#include "Ray.hpp"
+
+/* The alignment (in bytes) of the arrays in the SphereStore. Large enough for AVX loads. */
+#define SPHERESTORE_ALIGNMENT 32
+/* The number of scalars that fit in SPHERESTORE_ALIGNMENT bytes. The length of each array is a multiple of this, so that every array starts aligned. */
+#define SPHERESTORE_LANES (SPHERESTORE_ALIGNMENT / sizeof(scalar))
+/* The number of spheres tested at once by SphereStore::hit(). Each array has at least SPHERESTORE_WIDTH - 1 padding lanes at the end, so the last block of any range can be loaded as a whole. */
+#if defined FLOAT32 && defined __AVX__
+#define SPHERESTORE_WIDTH 8
+#else
+#define SPHERESTORE_WIDTH 4
+#endif
+
+namespace RayTracer {
+    class SphereStore {
+        private:
+            /* One block of memory containing all five arrays back-to-back. */
+            scalar* data;
+            /* The number of objects stored. */
+            size_t n;
+            /* The length of each array, which is n plus SPHERESTORE_WIDTH - 1 padding lanes, rounded up to SPHERESTORE_LANES. */
+            size_t capacity;
+            /* Whether any of the stored objects is not a sphere. */
+            bool others;
+
+            /* Returns the size (in bytes) of the block of memory for the current capacity. */
+            inline size_t bytes() const { return ((4 * sizeof(scalar) + sizeof(uint32_t)) * this->capacity + SPHERESTORE_ALIGNMENT - 1) / SPHERESTORE_ALIGNMENT * SPHERESTORE_ALIGNMENT; }
+            /* (Re)allocates the internal arrays to fit at least n objects. */
+            void resize(size_t n);
+        public:
+            /* The x-coordinates of the centers. */
+            scalar* x;
+            /* The y-coordinates of the centers. */
+            scalar* y;
+            /* The z-coordinates of the centers. */
+            scalar* z;
+            /* The radii of the spheres, or NaN for objects that aren't spheres. */
+            scalar* radius;
+            /* The indices of the materials of the spheres in the MaterialTable of the world, or 0 for objects that aren't spheres. */
+            uint32_t* material;
+
+            /* The SphereStore class keeps packed sphere data for SIMD hitting. This constructor creates an empty store. */
+            SphereStore();
+            /* Copy constructor for the SphereStore class. */
+            SphereStore(const SphereStore& other);
+            /* Move constructor for the SphereStore class. */
+            SphereStore(SphereStore&& other);
+            /* Deconstructor for the SphereStore class. */
+            ~SphereStore();
+
+            /* Copies the centers, radii and materials from the given list of objects, such that index i in the store corresponds to index i in the list. */
+            void update(const std::vector<RenderObject*>& objects);
+
+            /* Hits given ray with the spheres in [start, start + n), and returns whether any is hit. If so, index and t are set to the closest one. Note that t_min and t_max are exclusive, just like Sphere::hit(). */
+            bool hit(const Ray& ray, size_t start, size_t n, scalar t_min, scalar t_max, size_t& index, scalar& t) const;
+
+            /* Returns whether the object at given index is a sphere. */
+            inline bool is_sphere(size_t index) const { return !std::isnan(this->radius[index]); }
+            /* Returns whether any of the stored objects is not a sphere. */
+            inline bool has_others() const { return this->others; }
+            /* Returns the number of objects in the store. */
+            inline size_t size() const { return this->n; }
+
+            /* Copy assignment operator for the SphereStore class. */
+            SphereStore& operator=(SphereStore other);
+            /* Move assignment operator for the SphereStore class. */
+            SphereStore& operator=(SphereStore&& other);
+            /* Swap operator for the SphereStore class. */
+            friend void swap(SphereStore& first, SphereStore& second);
+    };
+
+    /* Swap operator for the SphereStore class. */
+    void swap(SphereStore& first, SphereStore& second);
+}
+
+#endif
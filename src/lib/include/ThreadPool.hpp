@@ -4,7 +4,7 @@
  * Created:
  *   1/25/2020, 5:11:12 PM
  * Last edited:
- *   2/9/2020, 5:37:31 PM
+ *   18/10/2026, 17:02:40
  * Auto updated?
  *   Yes
  *
@@ -12,6 +12,12 @@
  *   The ThreadPool class is a collection of threads that are functioning
  *   as a thread pool. The idea is that they execute the same function
  *   multiple times with different data, until the stop signal is given.
+ *   The tiles of an image are divided over the workers, each of which
+ *   has its own queue. Workers that run out of work steal from the back
+ *   of the queues of the others, so no global lock is taken per tile.
+ *   New work can be started before earlier work is done, in which case
+ *   its tiles are queued behind those of the earlier work, so that the
+ *   workers never run dry between frames.
  *   This particular file is the header file for ThreadPool.cpp.
 **/
 
@@ -20,77 +26,97 @@
 
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <vector>
+#include <memory>
+#include <functional>
 #include <condition_variable>
 
 #include "RenderWorld.hpp"
 #include "Image.hpp"
 #include "Camera.hpp"
+#include "Tiles.hpp"
 
 namespace RayTracer {
-    struct PixelBatch {
-        int x1;
-        int y1;
-        int x2;
-        int y2;
+    /* One batch of tiles given to the ThreadPool with start(), together with the job that renders them. */
+    struct ThreadPoolWork {
+        /* The function that is called for every tile of the work */
+        std::function<void(const Tile&)> job;
+        /* The number of tiles of the work that aren't rendered yet */
+        std::atomic<size_t> n_remaining;
+        /* The number of pixels of the work that are rendered */
+        std::atomic<unsigned long> n_done;
+    };
+
+    /* A tile in the queue of a worker, together with the work it is part of. */
+    struct WorkerTile {
+        /* The tile to render. */
+        Tile tile;
+        /* The work the tile belongs to, which is kept alive until all of its tiles are rendered. */
+        std::shared_ptr<ThreadPoolWork> work;
+    };
 
-        const Camera* camera;
-        const RenderWorld* world;
-        Image* out;
+    /* The tiles owned by one worker, ordered by the work they belong to. The owner takes them from the front, other workers steal from the back of the oldest work. */
+    struct WorkerQueue {
+        /* Protects the tiles. Only ever contended when a tile is stolen. */
+        std::mutex lock;
+        /* The tiles that still have to be rendered. */
+        std::deque<WorkerTile> tiles;
     };
 
     class ThreadPool {
         private:
-            unsigned int width;
-            unsigned int height;
-            
-            unsigned int max_in_queue;
             unsigned int n_threads;
-            unsigned int batch_size;
 
-            unsigned int threads_waiting;
             bool working;
+            /* Increased every time new work is started, so that sleeping workers know there is something to do. */
+            unsigned long generation;
 
             /* The list of thread objects */
             std::vector<std::thread> pool;
+            /* One queue of tiles per worker */
+            std::vector<WorkerQueue> queues;
+            /* The work that was started last */
+            std::shared_ptr<ThreadPoolWork> current;
 
-            /* Queue for the batches */
-            std::vector<PixelBatch> batch_queue;
-            /* Mutex object for to access the queue */
-            std::mutex batch_lock;
-            /* Condition variable to access the queue */
-            std::condition_variable batch_cond;
-            /* Mutex object for signalling the farmer thread */
-            std::mutex wake_lock;
-            /* Condition variable to wake up the farmer thread */
-            std::condition_variable wake_cond;
+            /* Mutex object that protects working, generation and current, and that is used by both condition variables */
+            std::mutex state_lock;
+            /* Condition variable to wake up the workers when new work is started */
+            std::condition_variable work_cond;
+            /* Condition variable to wake up the threads waiting for work to complete */
+            std::condition_variable done_cond;
 
             /* Thread worker function */
             void worker(unsigned int id);
-            /* Function for rendering one batch of pixels */
-            void render_batch(const PixelBatch& batch) const;
+            /* Takes the next tile from the worker's own queue, or steals one from another queue if it's empty. Returns false if there is no work left at all. */
+            bool take_tile(unsigned int id, WorkerTile& tile);
         public:
             /* The ThreadPool class is used for multicore rendering. */
-            ThreadPool(unsigned int num_of_threads, unsigned int batch_size, unsigned int max_in_queue=5);
+            ThreadPool(unsigned int num_of_threads);
             ~ThreadPool();
 
-            /* Returns whether the batch queue is full or not. */
-            bool batch_queue_full() const;
-            /* Adds a new batch to the queue, ready for processing. If the queue is full, returns without doing anything. */
-            void add_batch(const PixelBatch& batch);
-            /* Adds a new batch to the queue. Instead of supplying the batch, it is created and then populated using the given values. */
-            void add_batch(unsigned int width, unsigned int height, const Camera& cam, const RenderWorld& world, Image& out, unsigned long& batch_index);
-            /* Returns a the indices for a new batch */
-            PixelBatch get_batch(unsigned int width, unsigned int height, unsigned long& batch_index) const;
-
-            /* Uses a conditional variable to pause the thread until any of the worker threads wake it up */
-            void wait();
+            /* Lets the workers call the given job for each of the given tiles. Consecutive tiles are given to the same worker as much as possible, so the order of the tiles matters. If earlier work isn't done yet, the tiles are rendered after its tiles. Returns immediately with a handle to the work; use complete() or wait_for() to wait until all tiles are done. */
+            std::shared_ptr<ThreadPoolWork> start(const std::vector<Tile>& tiles, const std::function<void(const Tile&)>& job);
+            /* Lets the workers render the given tiles of the image with RenderWorld::render_tile(). Note that all arguments must stay alive until the work is complete. */
+            std::shared_ptr<ThreadPoolWork> start(const std::vector<Tile>& tiles, const Camera& cam, const RenderWorld& world, Image& out, uint64_t seed);
+            /* Waits at most the given time for the given work to complete, and returns whether it did. */
+            bool wait_for(const std::shared_ptr<ThreadPoolWork>& work, std::chrono::milliseconds timeout);
+            /* Waits at most the given time for the work that was started last to complete, and returns whether it did. */
+            bool wait_for(std::chrono::milliseconds timeout);
+            /* Returns the number of pixels of the given work that are rendered so far. */
+            unsigned long progress(const std::shared_ptr<ThreadPoolWork>& work) const;
+            /* Returns the number of pixels of the work that was started last that are rendered so far. */
+            unsigned long progress() const;
 
             /* Stops the threadpool and waits until all threads have joined. */
             void stop();
-            /* Stops the threadpool, but waits until the buffer is empty for it to happen. */
+            /* Waits until the given work is rendered. */
+            void complete(const std::shared_ptr<ThreadPoolWork>& work);
+            /* Waits until the work that was started last is rendered. */
             void complete();
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,56 @@
+/* TILES.hpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 17:31:08
+ * Last edited:
+ *   18/10/2026, 17:31:08
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   Splits an image into rectangular tiles, which are the units of work
+ *   for the renderer. Rendering a compact tile instead of a long strip of
+ *   a scanline keeps the rays that are in flight on one core close
+ *   together, so that they hit the same parts of the object tree. The
+ *   tiles can be put in scanline, Morton (Z-curve) or Hilbert order. This
+ *   particular file is the header file for Tiles.cpp.
+**/
+
+#ifndef TILES_HPP
+#define TILES_HPP
+
+#include <string>
+#include <vector>
+
+namespace RayTracer {
+    enum TileOrder {
+        scanline_order,
+        morton_order,
+        hilbert_order
+    };
+    static std::string TileOrderNames[] = {
+        "scanline",
+        "morton",
+        "hilbert"
+    };
+
+    struct Tile {
+        /* The x-coordinate of the leftmost column of the tile. */
+        int x1;
+        /* The y-coordinate of the top row of the tile. */
+        int y1;
+        /* The x-coordinate of the rightmost column of the tile (inclusive). */
+        int x2;
+        /* The y-coordinate of the bottom row of the tile (inclusive). */
+        int y2;
+
+        /* Returns the number of pixels in the tile. */
+        inline unsigned long size() const { return (unsigned long) (this->x2 - this->x1 + 1) * (this->y2 - this->y1 + 1); }
+    };
+
+    /* Splits an image of given size into tiles of at most tile_width x tile_height pixels, and returns them in the given order. Tiles at the right and bottom edge are cut off to fit the image. */
+    std::vector<Tile> make_tiles(unsigned int width, unsigned int height, unsigned int tile_width, unsigned int tile_height, TileOrder order);
+}
+
+#endif
@@ -11,109 +11,129 @@
  * Description:
  *   The Vec3 class is a custom-written vector class. It holds three
  *   values: x, y and z, and contains several useful math functions for
- *   vectors in rendering. This specific file is the header file for
- *   Vec3.cpp.
+ *   vectors in rendering. All math is defined inline in this header so
+ *   that the compiler can inline it into the hot loops of the tracer;
+ *   Vec3.cpp only contains the conversion from and to json.
 **/
 
 #ifndef VEC3_HPP
 #define VEC3_HPP
 
 #include <math.h>
+#include <stdexcept>
+#include <string>
 #include "json.hpp"
+#include "Scalar.hpp"
 
 namespace RayTracer {
     class Vec3 {
         public:
             /* The x value (first) in the vector. */
-            double x;
+            scalar x;
             /* The y value (second) in the vector. */
-            double y;
+            scalar y;
             /* The z value (third) in the vector. */
-            double z;
+            scalar z;
 
             /* The Vec3 class provides math for a three-dimensional positional vector. The default version is initialized to (0,0,0). */
-            Vec3();
+            constexpr Vec3(): x(0), y(0), z(0) {}
             /* The Vec3 class provides math for a three-dimensional positional vector. This version is initialized with the given x, y and z. */
-            Vec3(double x, double y, double z);
-
-            /* Copy operator for the Vec3 class. */
-            Vec3& operator=(const Vec3& other);
+            constexpr Vec3(scalar x, scalar y, scalar z): x(x), y(y), z(z) {}
 
             /* Positive sign operator for the Vec3 class. */
-            Vec3 operator+() const;
+            constexpr Vec3 operator+() const { return *this; }
             /* Changing addition operator for the Vec3 class. */
-            Vec3& operator+=(const Vec3& other);
-            /* Changing addition operator for the Vec3 class, but then with a double. */
-            Vec3& operator+=(const double other);
+            constexpr Vec3& operator+=(const Vec3& other) { this->x += other.x; this->y += other.y; this->z += other.z; return *this; }
+            /* Changing addition operator for the Vec3 class, but then with a scalar. */
+            constexpr Vec3& operator+=(const scalar other) { this->x += other; this->y += other; this->z += other; return *this; }
 
             /* Negative sign operator for the Vec3 class. */
-            Vec3 operator-() const;
+            constexpr Vec3 operator-() const { return Vec3(-this->x, -this->y, -this->z); }
             /* Changing subtraction operator for the Vec3 class. */
-            Vec3& operator-=(const Vec3& other);
-            /* Changing subtraction operator for the Vec3 class, but then with a double. */
-            Vec3& operator-=(const double other);
+            constexpr Vec3& operator-=(const Vec3& other) { this->x -= other.x; this->y -= other.y; this->z -= other.z; return *this; }
+            /* Changing subtraction operator for the Vec3 class, but then with a scalar. */
+            constexpr Vec3& operator-=(const scalar other) { this->x -= other; this->y -= other; this->z -= other; return *this; }
 
             /* Changing multiplication operator for the Vec3 class. */
-            Vec3& operator*=(const Vec3& other);
-            /* Changing multiplication operator for the Vec3 class, but then with a double. */
-            Vec3& operator*=(const double other);
+            constexpr Vec3& operator*=(const Vec3& other) { this->x *= other.x; this->y *= other.y; this->z *= other.z; return *this; }
+            /* Changing multiplication operator for the Vec3 class, but then with a scalar. */
+            constexpr Vec3& operator*=(const scalar other) { this->x *= other; this->y *= other; this->z *= other; return *this; }
 
             /* Changing dividation operator for the Vec3 class. */
-            Vec3& operator/=(const Vec3& other);
-            /* Changing dividation operator for the Vec3 class, but then with a double. */
-            Vec3& operator/=(const double other);
+            constexpr Vec3& operator/=(const Vec3& other) { this->x /= other.x; this->y /= other.y; this->z /= other.z; return *this; }
+            /* Changing dividation operator for the Vec3 class, but then with a scalar. */
+            constexpr Vec3& operator/=(const scalar other) { this->x /= other; this->y /= other; this->z /= other; return *this; }
 
             /* Provides array-like access to the three vector values. */
-            double& operator[](const int index);
+            constexpr scalar& operator[](const int index) {
+                if (index == 0) { return this->x; }
+                else if (index == 1) { return this->y; }
+                else if (index == 2) { return this->z; }
+                throw std::out_of_range("Index " + std::to_string(index) + " is out of range for Vec3");
+            }
             /* Constant, integer-based access to the vector values. */
-            double get(const int index) const;
+            constexpr scalar get(const int index) const {
+                if (index == 0) { return this->x; }
+                else if (index == 1) { return this->y; }
+                else if (index == 2) { return this->z; }
+                throw std::out_of_range("Index " + std::to_string(index) + " is out of range for Vec3");
+            }
 
-            /* Returns the length of the vector. */
-            double length() const;
             /* Returns the length squared of the vector. */
-            double squared_length() const;
+            constexpr scalar squared_length() const { return this->x * this->x + this->y * this->y + this->z * this->z; }
+            /* Returns the length of the vector. */
+            inline scalar length() const { return std::sqrt(this->squared_length()); }
 
             /* Returns the normalized version of this vector. */
-            Vec3 normalize() const;
-
-            /* Returns a json object describing this Vec3 object. */
-            virtual nlohmann::json to_json() const;
-            /* Returns a fresh Vec3 object as described in given json object. */
-            static Vec3 from_json(nlohmann::json json_obj);
+            inline Vec3 normalize() const {
+                scalar l = this->length();
+                return Vec3(this->x / l, this->y / l, this->z / l);
+            }
     };
 
     /* Constant addition operator for the Vec3 class (Vec3 + Vec3). */
-    Vec3 operator+(const Vec3& v1, const Vec3& v2);
-    /* Constant addition operator for the Vec3 class (Vec3 + double). */
-    Vec3 operator+(const Vec3& v1, const double n);
-    /* Constant addition operator for the Vec3 class (double + Vec3). */
-    Vec3 operator+(const double n, const Vec3& v2);
-
-    /* Constant addition operator for the Vec3 class (Vec3 - Vec3). */
-    Vec3 operator-(const Vec3& v1, const Vec3& v2);
-    /* Constant addition operator for the Vec3 class (Vec3 - double). */
-    Vec3 operator-(const Vec3& v1, const double n);
-    /* Constant addition operator for the Vec3 class (double - Vec3). */
-    Vec3 operator-(const double n, const Vec3& v2);
-
-    /* Constant addition operator for the Vec3 class (Vec3 * Vec3). */
-    Vec3 operator*(const Vec3& v1, const Vec3& v2);
-    /* Constant addition operator for the Vec3 class (Vec3 * double). */
-    Vec3 operator*(const Vec3& v1, const double n);
-    /* Constant addition operator for the Vec3 class (double * Vec3). */
-    Vec3 operator*(const double n, const Vec3& v2);
-
-    /* Constant addition operator for the Vec3 class (Vec3 / Vec3). */
-    Vec3 operator/(const Vec3& v1, const Vec3& v2);
-    /* Constant addition operator for the Vec3 class (Vec3 / double). */
-    Vec3 operator/(const Vec3& v1, const double n);
-    /* Constant addition operator for the Vec3 class (double / Vec3). */
-    Vec3 operator/(const double n, const Vec3& v2);
+    constexpr Vec3 operator+(const Vec3& v1, const Vec3& v2) { return Vec3(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z); }
+    /* Constant addition operator for the Vec3 class (Vec3 + scalar). */
+    constexpr Vec3 operator+(const Vec3& v1, const scalar n) { return Vec3(v1.x + n, v1.y + n, v1.z + n); }
+    /* Constant addition operator for the Vec3 class (scalar + Vec3). */
+    constexpr Vec3 operator+(const scalar n, const Vec3& v2) { return Vec3(n + v2.x, n + v2.y, n + v2.z); }
+
+    /* Constant subtraction operator for the Vec3 class (Vec3 - Vec3). */
+    constexpr Vec3 operator-(const Vec3& v1, const Vec3& v2) { return Vec3(v1.x - v2.x, v1.y - v2.y, v1.z - v2.z); }
+    /* Constant subtraction operator for the Vec3 class (Vec3 - scalar). */
+    constexpr Vec3 operator-(const Vec3& v1, const scalar n) { return Vec3(v1.x - n, v1.y - n, v1.z - n); }
+    /* Constant subtraction operator for the Vec3 class (scalar - Vec3). */
+    constexpr Vec3 operator-(const scalar n, const Vec3& v2) { return Vec3(n - v2.x, n - v2.y, n - v2.z); }
+
+    /* Constant multiplication operator for the Vec3 class (Vec3 * Vec3). */
+    constexpr Vec3 operator*(const Vec3& v1, const Vec3& v2) { return Vec3(v1.x * v2.x, v1.y * v2.y, v1.z * v2.z); }
+    /* Constant multiplication operator for the Vec3 class (Vec3 * scalar). */
+    constexpr Vec3 operator*(const Vec3& v1, const scalar n) { return Vec3(v1.x * n, v1.y * n, v1.z * n); }
+    /* Constant multiplication operator for the Vec3 class (scalar * Vec3). */
+    constexpr Vec3 operator*(const scalar n, const Vec3& v2) { return Vec3(n * v2.x, n * v2.y, n * v2.z); }
+
+    /* Constant division operator for the Vec3 class (Vec3 / Vec3). */
+    constexpr Vec3 operator/(const Vec3& v1, const Vec3& v2) { return Vec3(v1.x / v2.x, v1.y / v2.y, v1.z / v2.z); }
+    /* Constant division operator for the Vec3 class (Vec3 / scalar). */
+    constexpr Vec3 operator/(const Vec3& v1, const scalar n) { return Vec3(v1.x / n, v1.y / n, v1.z / n); }
+    /* Constant division operator for the Vec3 class (scalar / Vec3). */
+    constexpr Vec3 operator/(const scalar n, const Vec3& v2) { return Vec3(n / v2.x, n / v2.y, n / v2.z); }
 
     /* Returns the dot product of two vectors. */
-    double dot(const Vec3& v1, const Vec3& v2);
+    constexpr scalar dot(const Vec3& v1, const Vec3& v2) { return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z; }
     /* Returns the cross product of two vectors. */
-    Vec3 cross(const Vec3& v1, const Vec3& v2);
+    constexpr Vec3 cross(const Vec3& v1, const Vec3& v2) {
+        return Vec3(
+            v1.y * v2.z - v1.z * v2.y,
+            v1.z * v2.x - v1.x * v2.z,
+            v1.x * v2.y - v1.y * v2.x
+        );
+    }
+
+    /* Writes given Vec3 to given json object as an array of three numbers. Called by nlohmann::json when a Vec3 is assigned to it. */
+    void to_json(nlohmann::json& json_obj, const Vec3& vec);
+    /* Reads given json object, which must be an array of three numbers, into given Vec3. Called by nlohmann::json for get<Vec3>(). */
+    void from_json(const nlohmann::json& json_obj, Vec3& vec);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -31,8 +31,8 @@ namespace RayTracer {
             /* Clone constructor for the Dielectric class. Basically a copy constructor, except that it allocates it (so it needs deallocating) and that the return type is Material*. */
             virtual Material* clone() const;
 
-            /* Computes how a ray reflects from or travels through the surface of the material. */
-            virtual bool scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out) const;
+            /* Computes how a ray reflects from or travels through the surface of the material. Any randomness is drawn from given generator. */
+            virtual bool scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const;
             /* Computes the reflection of given ray over given normal. */
             virtual Vec3 reflect(const Vec3& v, const Vec3& n) const;
             /* Computes how a ray refracts when breaking through or out the surface of this RenderObject. */
@@ -32,8 +32,8 @@ namespace RayTracer {
             /* Clone constructor for the Lambertian class. Basically a copy constructor, except that it allocates it (so it needs deallocating) and that the return type is Material*. */
             virtual Material* clone() const;
 
-            /* Computes how a ray reflects from or travels through the surface of the material. */
-            virtual bool scatter(const Ray&, const HitRecord& record, Vec3& attenuation, Ray& ray_out) const;
+            /* Computes how a ray reflects from or travels through the surface of the material. Any randomness is drawn from given generator. */
+            virtual bool scatter(const Ray&, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const;
 
             /* Returns a json object describing this Lambertian object. */
             virtual nlohmann::json to_json() const;
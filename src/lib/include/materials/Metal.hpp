@@ -31,8 +31,10 @@ namespace RayTracer {
             /* Clone constructor for the Metal class. Basically a copy constructor, except that it allocates it (so it needs deallocating) and that the return type is Material*. */
             virtual Material* clone() const;
 
-            /* Computes how a ray reflects from or travels through the surface of the material. */
-            virtual bool scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out) const;
+            /* Computes how a ray reflects from or travels through the surface of the material. Any randomness is drawn from given generator. */
+            virtual bool scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const;
+            /* Returns whether rays that hit the material close to each other also leave it in similar directions, which is only the case without any fuzz. */
+            virtual bool is_coherent() const;
             /* Computes the reflection of given ray over given normal. */
             virtual Vec3 reflect(const Vec3& v, const Vec3& n) const;
 
@@ -46,7 +46,7 @@ namespace RayTracer {
             virtual bool compute_hit_box();
 
             /* Returns the closest hit object from the internal collection of objects. */
-            virtual bool hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const;
+            virtual bool hit(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const;
 
             /* Returns the colour of any of the objects indicated by the hitpoint. */
             virtual Vec3 colour(const HitRecord& record) const;
@@ -62,7 +62,7 @@ namespace RayTracer {
             /* Returns a json object representing this RenderObjectCollection object */
             virtual nlohmann::json to_json() const;
             /* Creates a newly allocated RenderObjectCollection object from given json object. Note that the new object will have to be deallocated manually. */
-            static RenderObjectCollection* from_json(nlohmann::json json_obj);
+            static RenderObjectCollection* from_json(nlohmann::json json_obj, MaterialTable& materials);
     };
 }
 
@@ -21,21 +21,21 @@
 #include "json.hpp"
 
 #include "RenderObject.hpp"
-#include "Material.hpp"
 
 namespace RayTracer {
     class Sphere: public RenderObject {
         public:
-            double radius;
-            Material* material;
+            scalar radius;
+            /* The index of the material of the sphere in the MaterialTable of the world. */
+            uint32_t material;
 
-            /* The Sphere class computes how a ray interacts with a Sphere object. The Sphere is defined by an origin (vector) and a radius. */
-            Sphere(const Vec3& origin, double radius, Material* material);
+            /* The Sphere class computes how a ray interacts with a Sphere object. The Sphere is defined by an origin (vector), a radius and the index of its material, as returned by RenderWorld::add_material(). */
+            Sphere(const Vec3& origin, scalar radius, uint32_t material);
             /* Copy constructor for the Sphere class. */
             Sphere(const Sphere& other);
             /* Move constructor for the Sphere class. */
             Sphere(Sphere&& other);
-            virtual ~Sphere();
+            virtual ~Sphere() = default;
 
             /* The clone method returns a reference to a new RenderObject method. */
             virtual RenderObject* clone() const;
@@ -44,7 +44,7 @@ namespace RayTracer {
             virtual bool compute_hit_box();
 
             /* Computes whether given Ray hits this Sphere. If it doesn't, return a t of -1. If it does, returns the length of the Ray until it hits the Sphere. Not that t_min and t_max are exclusive. */
-            virtual bool hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const;
+            virtual bool hit(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const;
 
             /* Returns the colour at the hitpoint of the Sphere. */
             virtual Vec3 colour(const HitRecord& record) const;
@@ -54,8 +54,8 @@ namespace RayTracer {
 
             /* Returns a json object representing this Sphere object */
             virtual nlohmann::json to_json() const;
-            /* Creates a newly allocated Sphere object from given json object. Note that the new object will have to be deallocated manually. */
-            static Sphere* from_json(nlohmann::json json_obj);
+            /* Creates a newly allocated Sphere object from given json object. Its material is either an index in given table, or a material object that is added to it. Note that the new object will have to be deallocated manually. */
+            static Sphere* from_json(nlohmann::json json_obj, MaterialTable& materials);
     };
 }
 
@@ -40,7 +40,7 @@ Material* Dielectric::clone() const {
 
 
 
-bool Dielectric::scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out) const {
+bool Dielectric::scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const {
     Vec3 outward_normal;
     double ni_over_nt;
     attenuation = this->albedo;
@@ -66,7 +66,7 @@ bool Dielectric::scatter(const Ray& ray_in, const HitRecord& record, Vec3& atten
         reflect_prob = 1.0;
     }
 
-    if (random_double() < reflect_prob) {
+    if (random_double(rng) < reflect_prob) {
         ray_out = Ray(record.hitpoint, this->reflect(ray_in.direction, record.normal));
     } else {
         ray_out = Ray(record.hitpoint, refracted);
@@ -112,7 +112,7 @@ json Dielectric::to_json() const {
     this->baseclass_to_json(j);
 
     // Add our own properties
-    j["albedo"] = this->albedo.to_json();
+    j["albedo"] = this->albedo;
     j["ref_idx"] = this->ref_idx;
     return j;
 }
@@ -131,7 +131,7 @@ Dielectric* Dielectric::from_json(json json_obj) {
     }
 
     // Parse it
-    Vec3 albedo = Vec3::from_json(json_obj["albedo"]);
+    Vec3 albedo = json_obj["albedo"].get<Vec3>();
     double ref_idx;
     try {
         ref_idx = json_obj["ref_idx"].get<double>();
@@ -36,8 +36,8 @@ Material* Lambertian::clone() const {
 
 
 // NOTE: For self, attenuation is like the decay of light in the medium.
-bool Lambertian::scatter(const Ray&, const HitRecord& record, Vec3& attenuation, Ray& ray_out) const {
-    Vec3 target = record.hitpoint + record.normal + random_in_unit_sphere();
+bool Lambertian::scatter(const Ray&, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const {
+    Vec3 target = record.hitpoint + record.normal + random_in_unit_sphere(rng);
     ray_out = Ray(record.hitpoint, target - record.hitpoint);
     attenuation = this->albedo;
     return true;
@@ -52,7 +52,7 @@ nlohmann::json Lambertian::to_json() const {
     this->baseclass_to_json(j);
 
     // Add our own properties
-    j["albedo"] = this->albedo.to_json();
+    j["albedo"] = this->albedo;
     return j;
 }
 
@@ -68,7 +68,7 @@ Lambertian* Lambertian::from_json(nlohmann::json json_obj) {
     }
 
     // Parse it with the Vec3 parser
-    Vec3 albedo = Vec3::from_json(json_obj["albedo"]);
+    Vec3 albedo = json_obj["albedo"].get<Vec3>();
 
     return new Lambertian(albedo);
 }
\ No newline at end of file
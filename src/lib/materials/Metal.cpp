@@ -39,12 +39,15 @@ Material* Metal::clone() const {
 Vec3 Metal::reflect(const Vec3& v, const Vec3& n) const {
     return v - 2 * dot(n, v) * n;
 }
-bool Metal::scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out) const {
+bool Metal::scatter(const Ray& ray_in, const HitRecord& record, Vec3& attenuation, Ray& ray_out, Random& rng) const {
     Vec3 reflected = this->reflect(ray_in.direction.normalize(), record.normal);
-    ray_out = Ray(record.hitpoint, reflected + this->fuzz*random_in_unit_sphere());
+    ray_out = Ray(record.hitpoint, reflected + this->fuzz*random_in_unit_sphere(rng));
     attenuation = this->albedo;
     return (dot(ray_out.direction, record.normal) > 0);
 }
+bool Metal::is_coherent() const {
+    return this->fuzz == 0;
+}
 
 
 
@@ -55,7 +58,7 @@ json Metal::to_json() const {
     this->baseclass_to_json(j);
 
     // Add our own properties
-    j["albedo"] = this->albedo.to_json();
+    j["albedo"] = this->albedo;
     j["fuzz"] = this->fuzz;
     return j;
 }
@@ -74,7 +77,7 @@ Metal* Metal::from_json(json json_obj) {
     }
 
     // Parse it
-    Vec3 albedo = Vec3::from_json(json_obj["albedo"]);
+    Vec3 albedo = json_obj["albedo"].get<Vec3>();
     double fuzz;
     try {
         fuzz = json_obj["fuzz"].get<double>();
@@ -102,9 +102,9 @@ bool RenderObjectCollection::compute_hit_box() {
 
 
 
-bool RenderObjectCollection::hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const {
+bool RenderObjectCollection::hit(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const {
     HitRecord temp_record;
-    double t_best = t_max;
+    scalar t_best = t_max;
     bool hit = false;
     // Loop until we found the hit with the smallest t. By overriding t_max, we can easily and elegantly do this.
     for (std::size_t i = 0; i < this->objects.size(); i++) {
@@ -152,7 +152,7 @@ json RenderObjectCollection::to_json() const {
     }
     return j;
 }
-RenderObjectCollection* RenderObjectCollection::from_json(json json_obj) {
+RenderObjectCollection* RenderObjectCollection::from_json(json json_obj, MaterialTable& materials) {
     // Check if the object has an object type
     if (!json_obj.is_object()) {
         throw InvalidObjectFormat("RenderObjectCollection", json::object().type_name(), json_obj.type_name());
@@ -169,7 +169,7 @@ RenderObjectCollection* RenderObjectCollection::from_json(json json_obj) {
     // Parse all the items in this array
     vector<RenderObject*> objects;
     for (std::size_t i = 0; i < json_obj["objects"].size(); i++) {
-        objects.push_back(RenderObject::from_json(json_obj["objects"][i]));
+        objects.push_back(RenderObject::from_json(json_obj["objects"][i], materials));
     }
 
     return new RenderObjectCollection(objects);
@@ -20,18 +20,15 @@
 #include <stdexcept>
 
 #include "JSONExceptions.hpp"
+#include "MaterialTable.hpp"
 #include "Sphere.hpp"
 
-#if defined MACOS || defined _WIN32
-#define sqrtf64 sqrt
-#endif
-
 using namespace std;
 using namespace RayTracer;
 using namespace nlohmann;
 
 
-Sphere::Sphere(const Vec3& center, double radius, Material* material)
+Sphere::Sphere(const Vec3& center, scalar radius, uint32_t material)
     : RenderObject(center, sphere)
 {
     this->radius = radius;
@@ -45,7 +42,7 @@ Sphere::Sphere(const Sphere& other)
     : RenderObject(other.center, sphere)
 {
     this->radius = other.radius;
-    this->material = other.material->clone();
+    this->material = other.material;
 
     // Also copy the hitbox
     this->has_hitbox = other.has_hitbox;
@@ -59,7 +56,6 @@ Sphere::Sphere(Sphere&& other)
 {
     this->radius = other.radius;
     this->material = other.material;
-    other.material = nullptr;
 
     // Also copy the hitbox
     this->has_hitbox = other.has_hitbox;
@@ -68,10 +64,6 @@ Sphere::Sphere(Sphere&& other)
     }
 }
 
-Sphere::~Sphere() {
-    delete this->material;
-}
-
 RenderObject* Sphere::clone() const {
     return (RenderObject*) new Sphere(*this);
 }
@@ -86,20 +78,20 @@ bool Sphere::compute_hit_box() {
 
 
 
-bool Sphere::hit(const Ray& ray, double t_min, double t_max, HitRecord& record) const {
+bool Sphere::hit(const Ray& ray, scalar t_min, scalar t_max, HitRecord& record) const {
     Vec3 d_ray_sphere = ray.origin - this->center;
-    double a = dot(ray.direction, ray.direction);
-    double b = dot(d_ray_sphere, ray.direction);
-    double c = dot(d_ray_sphere, d_ray_sphere) - this->radius * this->radius;
+    scalar a = dot(ray.direction, ray.direction);
+    scalar b = dot(d_ray_sphere, ray.direction);
+    scalar c = dot(d_ray_sphere, d_ray_sphere) - this->radius * this->radius;
 
-    double D = b*b - a*c;
+    scalar D = b*b - a*c;
 
     // Return the distance the ray has travelled until it hits the closest side of the sphere.
     if (D > 0) {
         // Compute tboth variations of the t. If t - sqrt(D) is true, take that one. Otherwise, take the other.
-        double t = (-b - sqrtf64(D)) / a;
+        scalar t = (-b - sqrt(D)) / a;
         if (t <= t_min || t >= t_max) {
-            t = (-b + sqrtf64(D)) / a;
+            t = (-b + sqrt(D)) / a;
             if (t <= t_min || t >= t_max) {
                 return false;
             }
@@ -135,12 +127,12 @@ json Sphere::to_json() const {
     this->baseclass_to_json(j);
     
     // Add child-specific properties
-    j["center"] = this->center.to_json();
+    j["center"] = this->center;
     j["radius"] = this->radius;
-    j["material"] = this->material->to_json();
+    j["material"] = this->material;
     return j;
 }
-Sphere* Sphere::from_json(json json_obj) {
+Sphere* Sphere::from_json(json json_obj, MaterialTable& materials) {
     // Check if the object has an object type
     if (!json_obj.is_object()) {
         throw InvalidObjectFormat("Sphere", json::object().type_name(), json_obj.type_name());
@@ -158,14 +150,26 @@ Sphere* Sphere::from_json(json json_obj) {
     }
 
     // Parse them
-    Vec3 center = Vec3::from_json(json_obj["center"]);
+    Vec3 center = json_obj["center"].get<Vec3>();
     double radius;
     try {
         radius = json_obj["radius"].get<double>();
     } catch (nlohmann::detail::type_error&) {
         throw InvalidFieldFormat("Sphere", "radius", "double", json_obj["radius"].type_name());
     }
-    Material* mat = Material::from_json(json_obj["material"]);
 
-    return new Sphere(center, radius, mat);
+    // The material is either an index in the table, or a material of its own that we add to it
+    uint32_t material;
+    if (json_obj["material"].is_number_unsigned()) {
+        material = json_obj["material"].get<uint32_t>();
+        if (material >= materials.size()) {
+            throw InvalidIndexException("Sphere", "material", material, materials.size());
+        }
+    } else {
+        Material* mat = Material::from_json(json_obj["material"]);
+        material = materials.add(*mat);
+        delete mat;
+    }
+
+    return new Sphere(center, radius, material);
 }
\ No newline at end of file
@@ -32,7 +32,7 @@ using namespace RayTracer;
 
 extern "C" void init(RenderWorld& world) {
     // Add the objects required
-    world.add_object(new Sphere(Vec3(0, -1000, -0), 1000, new Lambertian(Vec3(0.5, 0.5, 0.5))));
+    world.add_object(new Sphere(Vec3(0, -1000, -0), 1000, world.add_material(Lambertian(Vec3(0.5, 0.5, 0.5)))));
     for (int a = -11; a < 11; a++) {
         for (int b = -11; b < 11; b++) {
             double choose_mat = random_double();
@@ -41,29 +41,29 @@ extern "C" void init(RenderWorld& world) {
                 if (choose_mat < 0.8) {
                     // Add a mat sphere
                     world.add_object(new Sphere(center, 0.2,
-                        new Lambertian(Vec3(random_double() * random_double(),
-                                            random_double() * random_double(),
-                                            random_double() * random_double()))));
+                        world.add_material(Lambertian(Vec3(random_double() * random_double(),
+                                                           random_double() * random_double(),
+                                                           random_double() * random_double())))));
                 } else if (choose_mat < 0.95) {
                     // Add a reflecting sphere
                     world.add_object(new Sphere(center, 0.2,
-                        new Metal(Vec3(random_double() * random_double(),
-                                       random_double() * random_double(),
-                                       random_double() * random_double()),
-                                  0.5 * random_double())));
+                        world.add_material(Metal(Vec3(random_double() * random_double(),
+                                                      random_double() * random_double(),
+                                                      random_double() * random_double()),
+                                                 0.5 * random_double()))));
                 } else {
                     // Add a refracting sphere
                     world.add_object(new Sphere(center, 0.2,
-                        new Dielectric(Vec3(1.0, 1.0, 1.0), 1.5)));
+                        world.add_material(Dielectric(Vec3(1.0, 1.0, 1.0), 1.5))));
                 }
             }
         }
     }
 
     // Finally, add the three big spheres
-    world.add_object(new Sphere(Vec3(0, 1, 0), 1.0, new Dielectric(Vec3(1.0, 1.0, 1.0), 1.5)));
-    world.add_object(new Sphere(Vec3(-4, 1, 0), 1.0, new Lambertian(Vec3(1.0, 0.3, 0.0))));
-    world.add_object(new Sphere(Vec3(4, 1, 0), 1.0, new Metal(Vec3(0.75, 0.75, 0.75), 0.2)));
+    world.add_object(new Sphere(Vec3(0, 1, 0), 1.0, world.add_material(Dielectric(Vec3(1.0, 1.0, 1.0), 1.5))));
+    world.add_object(new Sphere(Vec3(-4, 1, 0), 1.0, world.add_material(Lambertian(Vec3(1.0, 0.3, 0.0)))));
+    world.add_object(new Sphere(Vec3(4, 1, 0), 1.0, world.add_material(Metal(Vec3(0.75, 0.75, 0.75), 0.2))));
 
     // Optimize the tree
     world.optimize();
@@ -0,0 +1,88 @@
+/* BENCH HIT.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 19:41:05
+ * Last edited:
+ *   18/10/2026, 19:41:05
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   This file benchmarks the innermost math of the tracer. It shoots a
+ *   lot of random rays at a lot of random spheres, and reports how long
+ *   a single Sphere::hit() and BoundingBox::hit() take on average. Since
+ *   both are little more than Vec3 arithmetic, this mostly measures how
+ *   well the compiler can inline Vec3.
+**/
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+#include "../../src/lib/include/objects/Sphere.hpp"
+#include "../../src/lib/include/BoundingBox.hpp"
+#include "../../src/lib/include/Random.hpp"
+
+using namespace std;
+using namespace RayTracer;
+
+
+/* The number of spheres and rays used; every ray is hit with every sphere. */
+#define N_SPHERES 1000
+#define N_RAYS 2000
+/* The number of times every benchmark is repeated, of which the fastest one is reported. */
+#define N_RUNS 5
+
+/* Returns the fastest time in nanoseconds per call of given function, which is called once for every ray and sphere pair. */
+template <class F>
+double bench(const vector<Sphere*>& spheres, const vector<Ray>& rays, F hit, size_t& n_hits) {
+    double best = -1;
+    for (int r = 0; r < N_RUNS; r++) {
+        n_hits = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < rays.size(); i++) {
+            for (size_t j = 0; j < spheres.size(); j++) {
+                n_hits += hit(*spheres[j], rays[i]);
+            }
+        }
+        auto stop = chrono::steady_clock::now();
+        double ns = chrono::duration_cast<chrono::nanoseconds>(stop - start).count() / (double) (rays.size() * spheres.size());
+        if (best < 0 || ns < best) { best = ns; }
+    }
+    return best;
+}
+
+int main() {
+    cout << endl << "*** BENCHMARK FOR \"Sphere::hit()\" AND \"BoundingBox::hit()\" ***" << endl << endl;
+
+    Random rng(42);
+    vector<Sphere*> spheres;
+    for (int i = 0; i < N_SPHERES; i++) {
+        Vec3 center(20 * random_double(rng) - 10, 20 * random_double(rng) - 10, 20 * random_double(rng) - 10);
+        spheres.push_back(new Sphere(center, 0.1 + random_double(rng), 0));
+    }
+    vector<Ray> rays;
+    for (int i = 0; i < N_RAYS; i++) {
+        rays.push_back(Ray(Vec3(0, 0, 0), random_in_unit_sphere(rng)));
+    }
+    cout << "Hitting " << N_RAYS << " rays with " << N_SPHERES << " spheres, best of " << N_RUNS << " runs..." << endl;
+
+    size_t n_hits;
+    double ns = bench(spheres, rays, [](const Sphere& s, const Ray& ray) {
+        HitRecord record;
+        return s.hit(ray, 0, 1e30, record);
+    }, n_hits);
+    cout << "  Sphere::hit()      : " << ns << " ns/call (" << n_hits << " hits)" << endl;
+
+    ns = bench(spheres, rays, [](const Sphere& s, const Ray& ray) {
+        return s.box.hit(ray, 0, 1e30);
+    }, n_hits);
+    cout << "  BoundingBox::hit() : " << ns << " ns/call (" << n_hits << " hits)" << endl;
+
+    for (size_t i = 0; i < spheres.size(); i++) {
+        delete spheres[i];
+    }
+    cout << "Done" << endl << endl;
+    return 0;
+}
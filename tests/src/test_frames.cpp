@@ -14,6 +14,7 @@
 **/
 
 #include <thread>
+#include <fstream>
 #include <iostream>
 
 #include "../../src/lib/include/Frames.hpp"
@@ -26,7 +27,7 @@ bool test_animation() {
     cout << "Testing the animation class..." << endl;
 
     cout << "  Creating class with 10 frames..." << endl;
-    Frames ani(200, 100, 10, 1, "tests/bin/test_animation1", false);
+    Frames ani(200, 100, 10, 1, "tests/bin/test_animation1.y4m", false);
 
     cout << "  Rendering simple, moving square..." << endl;
     for (int i = 0; i < ani.n_frames; i++) {
@@ -41,8 +42,17 @@ bool test_animation() {
         ani.next();
     }
 
-    cout << "  Writing output images..." << endl;
-    ani.to_mp4("tests/bin/test_animation1/test.mp4");
+    cout << "  Writing video..." << endl;
+    ani.finish();
+
+    // Every frame is a header line followed by the full resolution Y, Cb and Cr planes
+    cout << "  Checking video size..." << endl;
+    ifstream video("tests/bin/test_animation1.y4m", ios::binary | ios::ate);
+    size_t expected = string("YUV4MPEG2 W200 H100 F1:1 Ip A1:1 C444\n").size() + 10 * (string("FRAME\n").size() + 3 * 200 * 100);
+    if ((size_t) video.tellg() != expected) {
+        cout << "Fail: video is " << video.tellg() << " bytes instead of " << expected << endl << endl;
+        return false;
+    }
 
     cout << "Success" << endl << endl;
     return true;
@@ -52,7 +62,7 @@ bool test_dynamic() {
     cout << "Testing the animation class with dynamic saving..." << endl;
 
     cout << "  Creating class with 10 frames..." << endl;
-    Frames ani(200, 100, 10, 1, "tests/bin/test_animation2", true);
+    Frames ani(200, 100, 10, 1, "tests/bin/test_animation2.mp4", true);
 
     cout << "  Rendering simple, moving square..." << endl;
     for (int i = 0; i < ani.n_frames; i++) {
@@ -70,8 +80,8 @@ bool test_dynamic() {
         this_thread::sleep_for(chrono::milliseconds(500));
     }
 
-    cout << "  Creating mp4..." << endl;
-    ani.to_mp4("tests/bin/test_animation2/test.mp4");
+    cout << "  Finishing mp4..." << endl;
+    ani.finish();
 
     cout << "Success" << endl << endl;
     return true;
@@ -11,14 +11,21 @@
  * Description:
  *   This file tests Image.cpp. It mainly checks if the pixels that were
  *   put it can go out again, and if the resulting file is in the expected
- *   format.
+ *   format. To test the threaded PNG writer as well, compile it with
+ *   -D THREADED.
 **/
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <limits>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
 
 #include "../../src/lib/include/Image.hpp"
+#include "../../src/lib/include/PNGWriter.hpp"
 
 
 using namespace std;
@@ -68,6 +75,58 @@ bool test_values() {
         return false;
     }
 }
+bool test_raw() {
+    cout << "Testing raw access of Image class..." << endl;
+
+    cout << "  Writing pixels with set()..." << endl;
+    Image img = Image(30, 20);
+    for (int y = 0; y < 20; y++) {
+        for (int x = 0; x < 30; x++) {
+            img.set(x, y, Vec3(x, y, x * y));
+        }
+    }
+
+    cout << "  Reading them back with row() and operator[]..." << endl;
+    for (int y = 0; y < 20; y++) {
+        const double* row = img.row(y);
+        for (int x = 0; x < 30; x++) {
+            double expected[3] = { (double) x, (double) y, (double) (x * y) };
+            for (int z = 0; z < 3; z++) {
+                if (row[3 * x + z] != expected[z] || img[y][x][z] != expected[z] || img.pixels()[3 * (y * 30 + x) + z] != expected[z]) {
+                    cout << "Failure: expected " << expected[z] << " @ (" << y << "," << x << "," << z << "), got " << row[3 * x + z] << endl << endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    cout << "Succes" << endl << endl;
+    return true;
+}
+
+bool test_bytes() {
+    cout << "Testing conversion of Image rows to bytes..." << endl;
+
+    cout << "  Writing values in and out of range..." << endl;
+    Image img = Image(3, 1);
+    img.set(0, 0, Vec3(0, 0.5, 1));
+    img.set(1, 0, Vec3(-0.5, 1.5, 300));
+    img.set(2, 0, Vec3(numeric_limits<double>::quiet_NaN(), -numeric_limits<double>::infinity(), numeric_limits<double>::infinity()));
+
+    cout << "  Converting them with row_to_bytes()..." << endl;
+    unsigned char bytes[9];
+    img.row_to_bytes(0, bytes);
+    unsigned char expected[9] = { 0, 127, 255, 0, 255, 255, 0, 0, 255 };
+    for (int i = 0; i < 9; i++) {
+        if (bytes[i] != expected[i]) {
+            cout << "Failure: expected " << (int) expected[i] << " @ " << i << ", got " << (int) bytes[i] << endl << endl;
+            return false;
+        }
+    }
+
+    cout << "Succes" << endl << endl;
+    return true;
+}
 bool test_png() {
     cout << "Writing test image..." << endl;
 
@@ -93,6 +152,108 @@ bool test_png() {
     img.to_png("test.png");
 
     cout << "Succes" << endl << endl;
+    return true;
+}
+
+/* Reads the four bytes at in as a big-endian number. */
+uint32_t get_uint32(const unsigned char* in) {
+    return ((uint32_t) in[0] << 24) | ((uint32_t) in[1] << 16) | ((uint32_t) in[2] << 8) | (uint32_t) in[3];
+}
+bool test_png_bands() {
+    cout << "Testing PNG files that are written in multiple bands..." << endl;
+
+    // Make the image large enough to be split in a couple of bands
+    unsigned int w = 1200;
+    unsigned int h = 6 * PNGWRITER_BAND_SIZE / (3 * w + 1) + 1;
+
+    cout << "  Creating noisy image (" << w << "x" << h << ")..." << endl;
+    Image img = Image(w, h);
+    srand(42);
+    for (unsigned int y = 0; y < h; y++) {
+        for (unsigned int x = 0; x < w; x++) {
+            img.set(x, y, Vec3(float(x) / float(w), float(y) / float(h), (rand() % 256) / 255.0));
+        }
+    }
+
+    cout << "  Writing with 4 threads..." << endl;
+    PNGOptions options;
+    options.n_threads = 4;
+    img.to_png("test_bands.png", options);
+
+    cout << "  Reading the chunks back..." << endl;
+    ifstream file("test_bands.png", ios::binary);
+    vector<unsigned char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    file.close();
+    vector<unsigned char> idat;
+    unsigned int n_idat = 0;
+    size_t i = 8;
+    while (i + 12 <= data.size()) {
+        uint32_t length = get_uint32(data.data() + i);
+        if (i + 12 + length > data.size()) { break; }
+        uLong crc = crc32(0L, data.data() + i + 4, length + 4);
+        if (crc != get_uint32(data.data() + i + 8 + length)) {
+            cout << "Failure: chunk @ " << i << " has an invalid checksum" << endl << endl;
+            return false;
+        }
+        if (memcmp(data.data() + i + 4, "IDAT", 4) == 0) {
+            idat.insert(idat.end(), data.data() + i + 8, data.data() + i + 8 + length);
+            n_idat++;
+        }
+        i += 12 + length;
+    }
+    if (n_idat < 2) {
+        cout << "Failure: expected multiple IDAT chunks, got " << n_idat << endl << endl;
+        return false;
+    }
+
+    cout << "  Inflating " << n_idat << " IDAT chunks..." << endl;
+    size_t stride = 3 * (size_t) w;
+    uLongf length = (uLongf) ((stride + 1) * h);
+    vector<unsigned char> raw(length);
+    if (uncompress(raw.data(), &length, idat.data(), (uLong) idat.size()) != Z_OK || length != raw.size()) {
+        cout << "Failure: could not inflate the image data" << endl << endl;
+        return false;
+    }
+
+    cout << "  Comparing the unfiltered rows with row_to_bytes()..." << endl;
+    vector<unsigned char> prev(stride, 0), cur(stride), expected(stride);
+    for (unsigned int y = 0; y < h; y++) {
+        const unsigned char* line = raw.data() + y * (stride + 1);
+        for (size_t x = 0; x < stride; x++) {
+            int a = x >= 3 ? cur[x - 3] : 0;
+            int b = prev[x];
+            int c = x >= 3 ? prev[x - 3] : 0;
+            int predicted;
+            switch (line[0]) {
+                case 0: predicted = 0; break;
+                case 1: predicted = a; break;
+                case 2: predicted = b; break;
+                case 3: predicted = (a + b) / 2; break;
+                case 4: {
+                    int p = a + b - c;
+                    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    predicted = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                    break;
+                }
+                default:
+                    cout << "Failure: unknown filter type " << (int) line[0] << " in row " << y << endl << endl;
+                    return false;
+            }
+            cur[x] = (unsigned char) (line[x + 1] + predicted);
+        }
+
+        img.row_to_bytes(y, expected.data());
+        for (size_t x = 0; x < stride; x++) {
+            if (cur[x] != expected[x]) {
+                cout << "Failure: expected " << (int) expected[x] << " @ (" << y << "," << x << "), got " << (int) cur[x] << endl << endl;
+                return false;
+            }
+        }
+        swap(prev, cur);
+    }
+
+    cout << "Succes" << endl << endl;
+    return true;
 }
 
 
@@ -102,9 +263,18 @@ int main() {
     if (!test_values()) {
         return 1;
     }
+    if (!test_raw()) {
+        return 1;
+    }
+    if (!test_bytes()) {
+        return 1;
+    }
     if (!test_png()) {
         return 1;
     }
+    if (!test_png_bands()) {
+        return 1;
+    }
 
     return 0;
 }
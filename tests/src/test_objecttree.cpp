@@ -0,0 +1,357 @@
+/* TEST OBJECT TREE.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 14:02:11
+ * Last edited:
+ *   18/10/2026, 14:02:11
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   This file tests ObjectTree.cpp. It fills a tree with a lot of random
+ *   spheres, and then checks if the optimised tree returns the same hits
+ *   as a brute-force search, for each of the build strategies and thread
+ *   counts and tree widths, and after the objects have moved and the tree
+ *   was refitted. It also hits the SphereStore behind the tree with ranges
+ *   that end at its final object, so that the last SIMD block sticks out
+ *   past the stored spheres, and checks that it returns the material of
+ *   the sphere that was hit and that its arrays are aligned. Lastly,
+ *   rays traced together as a packet are checked against the same rays
+ *   traced on their own, including packets larger than
+ *   OBJECTTREE_MAX_PACKET.
+**/
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "../../src/lib/include/ObjectTree.hpp"
+#include "../../src/lib/include/SphereStore.hpp"
+#include "../../src/lib/include/objects/Sphere.hpp"
+#include "../../src/lib/include/Random.hpp"
+
+using namespace std;
+using namespace RayTracer;
+
+
+/* Fills given tree with n random spheres. */
+void fill_tree(ObjectTree& tree, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        Vec3 center(100 * random_double() - 50, 100 * random_double() - 50, 100 * random_double() - 50);
+        tree.add(new Sphere(center, 0.1 + random_double(), 0));
+    }
+}
+
+/* Returns the closest hit among all objects of the tree the slow way. */
+bool brute_force_hit(ObjectTree& tree, const Ray& ray, HitRecord& record) {
+    double t_best = numeric_limits<double>::max();
+    bool hit = false;
+    for (size_t i = 0; i < tree.size(); i++) {
+        if (tree[i]->hit(ray, 0.0, t_best, record)) {
+            t_best = record.t;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+bool test_hits(ObjectTreeStrategy strategy, bool ordered, unsigned int n_threads, unsigned int width = 2) {
+    cout << "Testing hits with strategy '" << ObjectTreeStrategyNames[strategy] << "', " << (ordered ? "ordered" : "unordered") << " traversal, width " << width << " and " << n_threads << " thread(s)..." << endl;
+
+    cout << "  Creating tree with 5000 spheres..." << endl;
+    ObjectTree tree;
+    fill_tree(tree, 5000);
+    ObjectTreeOptions options;
+    options.strategy = strategy;
+    options.ordered_traversal = ordered;
+    options.n_threads = n_threads;
+    options.width = width;
+    tree.set_options(options);
+    tree.optimize();
+
+    cout << "  Shooting 10000 rays..." << endl;
+    for (int i = 0; i < 10000; i++) {
+        Ray ray(Vec3(0, 0, 0), random_in_unit_sphere());
+        HitRecord expected, got;
+        bool hit_expected = brute_force_hit(tree, ray, expected);
+        bool hit_got = tree.hit(ray, 0.0, numeric_limits<double>::max(), got);
+        if (hit_expected != hit_got || (hit_got && (expected.obj != got.obj || expected.t != got.t))) {
+            cerr << "  Ray " << i << " hits differently than the brute-force search" << endl;
+            cout << "Failure" << endl << endl;
+            return false;
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+bool test_packet(unsigned int size, bool coherent) {
+    cout << "Testing " << (coherent ? "coherent" : "divergent") << " packets of " << size << " rays..." << endl;
+
+    cout << "  Creating tree with 5000 spheres..." << endl;
+    ObjectTree tree;
+    fill_tree(tree, 5000);
+    tree.optimize();
+
+    cout << "  Shooting 1000 packets..." << endl;
+    vector<Ray> rays(size);
+    vector<HitRecord> records(size);
+    unique_ptr<bool[]> hits(new bool[size]);
+    for (int p = 0; p < 1000; p++) {
+        // Coherent packets start close together and point the same way, apart from the last ray which goes its own way
+        Vec3 origin(2 * random_double() - 1, 2 * random_double() - 1, -60);
+        Vec3 direction = Vec3(0, 0, 1) + 0.5 * random_in_unit_sphere();
+        for (unsigned int i = 0; i < size; i++) {
+            if (coherent && i + 1 < size) {
+                rays[i] = Ray(origin + 0.1 * random_in_unit_sphere(), direction + 0.01 * random_in_unit_sphere());
+            } else {
+                rays[i] = Ray(Vec3(0, 0, 0), random_in_unit_sphere());
+            }
+        }
+        tree.hit_packet(rays.data(), size, 0.0, numeric_limits<scalar>::max(), records.data(), hits.get());
+
+        for (unsigned int i = 0; i < size; i++) {
+            HitRecord expected;
+            bool hit_expected = tree.hit(rays[i], 0.0, numeric_limits<scalar>::max(), expected);
+            if (hit_expected != hits[i] || (hits[i] && (expected.obj != records[i].obj || expected.t != records[i].t))) {
+                cerr << "  Ray " << i << " of packet " << p << " hits differently than when traced on its own" << endl;
+                cout << "Failure" << endl << endl;
+                return false;
+            }
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+bool test_store_tail() {
+    cout << "Testing SphereStore hits on ranges that end at the final sphere..." << endl;
+
+    for (size_t n = 1; n <= 3 * SPHERESTORE_WIDTH + 1; n++) {
+        cout << "  Store with " << n << " spheres..." << endl;
+        vector<RenderObject*> objects;
+        for (size_t i = 0; i < n; i++) {
+            Vec3 center(4 * random_double() - 2, 4 * random_double() - 2, 4 * random_double() - 2);
+            objects.push_back(new Sphere(center, 0.2 + random_double(), (uint32_t) i));
+        }
+        SphereStore store;
+        store.update(objects);
+
+        bool success = true;
+        for (const void* array : { (const void*) store.x, (const void*) store.y, (const void*) store.z, (const void*) store.radius, (const void*) store.material }) {
+            if ((uintptr_t) array % SPHERESTORE_ALIGNMENT != 0) {
+                cerr << "  Store array at " << array << " is not aligned to " << SPHERESTORE_ALIGNMENT << " bytes" << endl;
+                success = false;
+            }
+        }
+        for (size_t start = 0; start < n && success; start++) {
+            for (int i = 0; i < 1000; i++) {
+                Ray ray(Vec3(0, 0, -10), Vec3(4 * random_double() - 2, 4 * random_double() - 2, 10));
+
+                // Find the closest sphere in [start, n) the slow way
+                HitRecord record;
+                double t_expected = numeric_limits<double>::max();
+                size_t index_expected = n;
+                for (size_t j = start; j < n; j++) {
+                    if (objects[j]->hit(ray, 0.0, t_expected, record)) {
+                        t_expected = record.t;
+                        index_expected = j;
+                    }
+                }
+
+                size_t index_got = n;
+                scalar t_got;
+                bool hit_got = store.hit(ray, start, n - start, 0.0, numeric_limits<scalar>::max(), index_got, t_got);
+                if (hit_got != (index_expected < n) || (hit_got && index_got != index_expected)) {
+                    cerr << "  Ray " << i << " hits differently than the brute-force search in range [" << start << ", " << n << ")" << endl;
+                    success = false;
+                    break;
+                }
+                if (hit_got && store.material[index_got] != record.material) {
+                    cerr << "  Ray " << i << " hits a sphere with material " << store.material[index_got] << " instead of " << record.material << endl;
+                    success = false;
+                    break;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            delete objects[i];
+        }
+        if (!success) {
+            cout << "Failure" << endl << endl;
+            return false;
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+bool test_small_leaves() {
+    cout << "Testing hits in small trees whose last leaf ends at the final object..." << endl;
+
+    for (size_t n = 1; n <= 11; n++) {
+        cout << "  Tree with " << n << " spheres..." << endl;
+        ObjectTree tree;
+        for (size_t i = 0; i < n; i++) {
+            Vec3 center(4 * random_double() - 2, 4 * random_double() - 2, 4 * random_double() - 2);
+            tree.add(new Sphere(center, 0.2 + random_double(), 0));
+        }
+        ObjectTreeOptions options;
+        options.max_leaf_size = 3;
+        tree.set_options(options);
+        tree.optimize();
+
+        for (int i = 0; i < 1000; i++) {
+            Ray ray(Vec3(0, 0, -10), Vec3(4 * random_double() - 2, 4 * random_double() - 2, 10));
+            HitRecord expected, got;
+            bool hit_expected = brute_force_hit(tree, ray, expected);
+            bool hit_got = tree.hit(ray, 0.0, numeric_limits<double>::max(), got);
+            if (hit_expected != hit_got || (hit_got && (expected.obj != got.obj || expected.t != got.t))) {
+                cerr << "  Ray " << i << " hits differently than the brute-force search" << endl;
+                cout << "Failure" << endl << endl;
+                return false;
+            }
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+bool test_deterministic() {
+    cout << "Testing if the parallel build equals the serial build..." << endl;
+
+    cout << "  Creating two trees with the same 20000 spheres..." << endl;
+    ObjectTree serial, parallel;
+    fill_tree(serial, 20000);
+    for (size_t i = 0; i < serial.size(); i++) {
+        parallel.add(serial[i]->clone());
+    }
+
+    ObjectTreeOptions options;
+    options.n_threads = 1;
+    serial.set_options(options);
+    serial.optimize();
+    options.n_threads = 8;
+    parallel.set_options(options);
+    parallel.optimize();
+
+    if (serial.n_nodes() != parallel.n_nodes()) {
+        cerr << "  Serial tree has " << serial.n_nodes() << " nodes, but parallel tree has " << parallel.n_nodes() << endl;
+        cout << "Failure" << endl << endl;
+        return false;
+    }
+
+    cout << "  Shooting 10000 rays..." << endl;
+    for (int i = 0; i < 10000; i++) {
+        Ray ray(Vec3(0, 0, 0), random_in_unit_sphere());
+        HitRecord r_serial, r_parallel;
+        bool hit_serial = serial.hit(ray, 0.0, numeric_limits<double>::max(), r_serial);
+        bool hit_parallel = parallel.hit(ray, 0.0, numeric_limits<double>::max(), r_parallel);
+        if (hit_serial != hit_parallel || (hit_serial && r_serial.t != r_parallel.t)) {
+            cerr << "  Ray " << i << " hits differently in the parallel tree" << endl;
+            cout << "Failure" << endl << endl;
+            return false;
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+bool test_refit() {
+    cout << "Testing hits after refitting a tree with moved objects..." << endl;
+
+    cout << "  Creating tree with 5000 spheres..." << endl;
+    ObjectTree tree;
+    fill_tree(tree, 5000);
+    ObjectTreeOptions options;
+    options.rebuild_threshold = 1000;
+    options.width = 4;
+    tree.set_options(options);
+    tree.optimize();
+
+    cout << "  Moving all spheres a bit..." << endl;
+    for (size_t i = 0; i < tree.size(); i++) {
+        tree[i]->center += Vec3(random_double() - 0.5, random_double() - 0.5, random_double() - 0.5);
+        tree[i]->compute_hit_box();
+    }
+    if (!tree.refit()) {
+        cerr << "  Tree was rebuilt instead of refitted" << endl;
+        cout << "Failure" << endl << endl;
+        return false;
+    }
+
+    cout << "  Shooting 10000 rays..." << endl;
+    for (int i = 0; i < 10000; i++) {
+        Ray ray(Vec3(0, 0, 0), random_in_unit_sphere());
+        HitRecord expected, got;
+        bool hit_expected = brute_force_hit(tree, ray, expected);
+        bool hit_got = tree.hit(ray, 0.0, numeric_limits<double>::max(), got);
+        if (hit_expected != hit_got || (hit_got && (expected.obj != got.obj || expected.t != got.t))) {
+            cerr << "  Ray " << i << " hits differently than the brute-force search" << endl;
+            cout << "Failure" << endl << endl;
+            return false;
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+int main() {
+    cout << endl << "*** TEST FOR \"ObjectTree.cpp\" ***" << endl << endl;
+    if (!test_hits(median_split, false, 1)) {
+        return -1;
+    }
+    if (!test_hits(binned_sah, false, 1)) {
+        return -1;
+    }
+    if (!test_hits(binned_sah, true, 1)) {
+        return -1;
+    }
+    if (!test_hits(binned_sah, true, 4)) {
+        return -1;
+    }
+    if (!test_hits(binned_sah, false, 1, 4)) {
+        return -1;
+    }
+    if (!test_hits(binned_sah, true, 1, 4)) {
+        return -1;
+    }
+    if (!test_hits(median_split, true, 1, 8)) {
+        return -1;
+    }
+    if (!test_hits(binned_sah, true, 1, 8)) {
+        return -1;
+    }
+    for (unsigned int size : { 4, 8, 16 }) {
+        if (!test_packet(size, true) || !test_packet(size, false)) {
+            return -1;
+        }
+    }
+    if (!test_store_tail()) {
+        return -1;
+    }
+    if (!test_small_leaves()) {
+        return -1;
+    }
+    if (!test_deterministic()) {
+        return -1;
+    }
+    if (!test_refit()) {
+        return -1;
+    }
+    // Packets larger than the maximum are traced in chunks
+    if (!test_packet(3 * OBJECTTREE_MAX_PACKET + 5, true) || !test_packet(3 * OBJECTTREE_MAX_PACKET + 5, false)) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+/* TEST TILES.cpp
+ *   by Lut99
+ *
+ * Created:
+ *   18/10/2026, 17:58:20
+ * Last edited:
+ *   18/10/2026, 17:58:20
+ * Auto updated?
+ *   Yes
+ *
+ * Description:
+ *   This file tests Tiles.cpp. It checks if the tiles cover every pixel
+ *   of images of awkward sizes exactly once in every order, and if the
+ *   Hilbert order only ever steps to a neighbouring tile.
+**/
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "../../src/lib/include/Tiles.hpp"
+
+using namespace std;
+using namespace RayTracer;
+
+
+bool test_coverage(TileOrder order) {
+    cout << "Testing coverage of tiles in " << TileOrderNames[order] << " order..." << endl;
+
+    unsigned int sizes[][4] = { { 100, 50, 16, 16 }, { 37, 91, 8, 5 }, { 1, 1, 16, 16 }, { 64, 64, 64, 1 } };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        unsigned int width = sizes[s][0], height = sizes[s][1];
+        cout << "  Tiling " << width << "x" << height << "px with " << sizes[s][2] << "x" << sizes[s][3] << "px tiles..." << endl;
+
+        vector<Tile> tiles = make_tiles(width, height, sizes[s][2], sizes[s][3], order);
+        vector<int> count(width * height, 0);
+        for (size_t i = 0; i < tiles.size(); i++) {
+            for (int y = tiles[i].y1; y <= tiles[i].y2; y++) {
+                for (int x = tiles[i].x1; x <= tiles[i].x2; x++) {
+                    if (x < 0 || y < 0 || x >= (int) width || y >= (int) height) {
+                        cerr << "  Tile " << i << " lies outside of the image" << endl;
+                        cout << "Failure" << endl << endl;
+                        return false;
+                    }
+                    count[y * width + x]++;
+                }
+            }
+        }
+        for (size_t i = 0; i < count.size(); i++) {
+            if (count[i] != 1) {
+                cerr << "  Pixel " << i << " is covered " << count[i] << " times" << endl;
+                cout << "Failure" << endl << endl;
+                return false;
+            }
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+bool test_hilbert_neighbours() {
+    cout << "Testing if the Hilbert order only steps to neighbouring tiles..." << endl;
+
+    cout << "  Tiling 256x256px with 16x16px tiles..." << endl;
+    vector<Tile> tiles = make_tiles(256, 256, 16, 16, hilbert_order);
+    for (size_t i = 1; i < tiles.size(); i++) {
+        int distance = abs(tiles[i].x1 - tiles[i - 1].x1) + abs(tiles[i].y1 - tiles[i - 1].y1);
+        if (distance != 16) {
+            cerr << "  Tile " << i << " is not next to tile " << i - 1 << endl;
+            cout << "Failure" << endl << endl;
+            return false;
+        }
+    }
+
+    cout << "Success" << endl << endl;
+    return true;
+}
+
+int main() {
+    cout << endl << "*** TEST FOR \"Tiles.cpp\" ***" << endl << endl;
+    if (!test_coverage(scanline_order)) {
+        return -1;
+    }
+    if (!test_coverage(morton_order)) {
+        return -1;
+    }
+    if (!test_coverage(hilbert_order)) {
+        return -1;
+    }
+    if (!test_hilbert_neighbours()) {
+        return -1;
+    }
+    return 0;
+}